@@ -0,0 +1,63 @@
+/*
+ * FrameSourceDefs.hpp
+ *
+ *  Created on: 18.10.2026
+ *     Project: Lightpack
+ *
+ *  Copyright (c) 2026 Lightpack contributors
+ *
+ *  Lightpack is very simple implementation of the backlight for a laptop
+ *
+ *  Lightpack is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Lightpack is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "BufferFormat.h"
+
+/*
+ * Raw frames fed to FrameSourceGrabber by other programs.
+ *
+ * Named pipe: every writer starts with a text line
+ *     PRFS <width> <height> <bytesPerLine> <bgra|rgba|argb|abgr>\n
+ * followed by frames of bytesPerLine * height bytes, e.g.
+ *     { echo "PRFS 1920 1080 7680 bgra"; ffmpeg -i movie.mkv -vf scale=1920:1080 -f rawvideo -pix_fmt bgra -; } > fifo
+ * The format is the byte order of a pixel as in ffmpeg pixel formats.
+ *
+ * POSIX shared memory: FRAMESOURCE_SHM_HEADER at offset 0, frames are written to a ring of
+ * slotsCount slots starting at dataOffset. Producer stores writeSequence with release semantics
+ * after the slot is written, the latest frame is in slot (writeSequence - 1) % slotsCount.
+ * The reader doesn't copy frames, it drops a frame whose slot the producer may have started to
+ * rewrite while it was read. At least 2 slots are required, keep 3 or more so frames aren't dropped.
+ * The layout is read once when the ring is mapped, the ring is remapped if the header changes.
+ */
+
+#define FRAMESOURCE_MAGIC "PRFS"
+#define FRAMESOURCE_VERSION 1
+#define FRAMESOURCE_MAX_SIDE 16384
+
+struct FRAMESOURCE_SHM_HEADER {
+    char magic[4];
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t bytesPerLine;
+    int32_t format; // BufferFormat, e.g. BufferFormatArgb for b, g, r, a bytes
+    uint32_t slotsCount;
+    uint32_t dataOffset;
+    uint64_t slotSize;
+    uint64_t writeSequence;
+};
@@ -37,12 +37,15 @@
 #   define D3D10_GRAB_SUPPORT
 #elif defined(Q_OS_UNIX)
 #   define X11_GRAB_SUPPORT
+#   define XCB_SHM_GRAB_SUPPORT
+#   define FRAME_SOURCE_GRAB_SUPPORT
 #endif
 
 #if defined(Q_OS_DARWIN) || defined(Q_OS_DARWIN64) || defined(Q_OS_MAC) || defined(Q_OS_MACX) || defined(Q_OS_MAC64)
 #   define MAC_OS
 #   define MAC_OS_CG_GRAB_SUPPORT
 #   undef X11_GRAB_SUPPORT
+#   undef XCB_SHM_GRAB_SUPPORT
 #endif
 
 #define DEBUG_OUT_RGB( RGB_VALUE ) \
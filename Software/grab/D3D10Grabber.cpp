@@ -225,9 +225,9 @@ public:
     void stop() { m_isStarted = false; }
     bool isStarted() const { return m_isStarted; }
 
-    QList< ScreenInfo > * screensWithWidgets(QList< ScreenInfo > * result, const QList<GrabWidget *> &grabWidgets)
+    QList< ScreenInfo > * screensWithWidgets(QList< ScreenInfo > * result, const QList<GrabZone> &grabZones)
     {
-        Q_UNUSED(grabWidgets);
+        Q_UNUSED(grabZones);
 
         result->clear();
         return result;
@@ -528,12 +528,12 @@ void D3D10Grabber::setGrabInterval(int msec) {
  * Just stub, we don't need to reallocate anything, and we suppose fullscreen application
  * runs on primary screen \see D3D10Grabber#init()
  * \param result
- * \param grabWidgets
+ * \param grabZones
  * \return
  */
-QList< ScreenInfo > * D3D10Grabber::screensWithWidgets(QList< ScreenInfo > * result, const QList<GrabWidget *> &grabWidgets)
+QList< ScreenInfo > * D3D10Grabber::screensWithWidgets(QList< ScreenInfo > * result, const QList<GrabZone> &grabZones)
 {
-    Q_UNUSED(grabWidgets);
+    Q_UNUSED(grabZones);
 
     DEBUG_HIGH_LEVEL << Q_FUNC_INFO << this->metaObject()->className();
     return result;
@@ -0,0 +1,175 @@
+/*
+ * FrameBufferArena.cpp
+ *
+ *  Created on: 18.10.2026
+ *     Project: Lightpack
+ *
+ *  Copyright (c) 2026 Lightpack contributors
+ *
+ *  Lightpack a USB content-driving ambient lighting system
+ *
+ *  Lightpack is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Lightpack is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "FrameBufferArena.hpp"
+#include <QtGlobal>
+#include <stdlib.h>
+
+#if defined(Q_OS_WIN)
+#include <malloc.h>
+#endif
+
+#if defined(Q_OS_LINUX)
+#include <sys/mman.h>
+#endif
+
+#include "../src/debug.h"
+
+FrameBufferArena::FrameBufferArena()
+    : _allocatedBytes(0)
+    , _freeBytes(0)
+    , _peakAllocatedBytes(0)
+{
+}
+
+FrameBufferArena::~FrameBufferArena()
+{
+    trim();
+    if (!_inUse.isEmpty())
+        qWarning() << Q_FUNC_INFO << _inUse.size() << "buffers are still in use";
+    for (QHash<unsigned char *, size_t>::const_iterator it = _inUse.constBegin(); it != _inUse.constEnd(); ++it)
+        freeAligned(it.key());
+}
+
+FrameBuffer FrameBufferArena::acquire(size_t size)
+{
+    QMutexLocker locker(&_mutex);
+
+    FrameBuffer buffer;
+    const size_t sizeClass = sizeClassOf(size);
+
+    QHash<size_t, QVector<unsigned char *> >::iterator freeList = _freeLists.find(sizeClass);
+    if (freeList != _freeLists.end() && !freeList->isEmpty()) {
+        buffer.ptr = freeList->last();
+        freeList->remove(freeList->size() - 1);
+        _freeBytes -= sizeClass;
+    } else {
+        buffer.ptr = allocateAligned(sizeClass);
+        if (buffer.ptr == NULL) {
+            qCritical() << Q_FUNC_INFO << "couldn't allocate" << sizeClass << "bytes";
+            return buffer;
+        }
+        _allocatedBytes += sizeClass;
+        _peakAllocatedBytes = qMax(_peakAllocatedBytes, _allocatedBytes);
+    }
+
+    buffer.size = sizeClass;
+    _inUse.insert(buffer.ptr, sizeClass);
+    return buffer;
+}
+
+void FrameBufferArena::release(const FrameBuffer &buffer)
+{
+    if (buffer.isNull())
+        return;
+
+    QMutexLocker locker(&_mutex);
+
+    QHash<unsigned char *, size_t>::iterator it = _inUse.find(buffer.ptr);
+    if (it == _inUse.end()) {
+        qCritical() << Q_FUNC_INFO << "buffer wasn't acquired from this arena or is released twice";
+        return;
+    }
+    const size_t sizeClass = it.value();
+    _inUse.erase(it);
+
+    if (_freeBytes + sizeClass > MaxFreeBytes) {
+        freeAligned(buffer.ptr);
+        _allocatedBytes -= sizeClass;
+        return;
+    }
+    _freeLists[sizeClass].append(buffer.ptr);
+    _freeBytes += sizeClass;
+}
+
+void FrameBufferArena::trim()
+{
+    QMutexLocker locker(&_mutex);
+
+    for (QHash<size_t, QVector<unsigned char *> >::iterator it = _freeLists.begin(); it != _freeLists.end(); ++it) {
+        for (int i = 0; i < it->size(); ++i) {
+            freeAligned(it->at(i));
+            _allocatedBytes -= it.key();
+        }
+    }
+    _freeLists.clear();
+    _freeBytes = 0;
+}
+
+size_t FrameBufferArena::allocatedBytes() const
+{
+    QMutexLocker locker(&_mutex);
+    return _allocatedBytes;
+}
+
+size_t FrameBufferArena::inUseBytes() const
+{
+    QMutexLocker locker(&_mutex);
+    return _allocatedBytes - _freeBytes;
+}
+
+size_t FrameBufferArena::peakAllocatedBytes() const
+{
+    QMutexLocker locker(&_mutex);
+    return _peakAllocatedBytes;
+}
+
+/*!
+  Sizes are rounded to cache lines, frame sized buffers to whole huge pages
+*/
+size_t FrameBufferArena::sizeClassOf(size_t size)
+{
+    if (size == 0)
+        size = 1;
+    const size_t granularity = size >= HugePageSize ? HugePageSize : Alignment;
+    return (size + granularity - 1) / granularity * granularity;
+}
+
+unsigned char * FrameBufferArena::allocateAligned(size_t size)
+{
+    const size_t alignment = size >= HugePageSize ? HugePageSize : Alignment;
+    void * ptr = NULL;
+#if defined(Q_OS_WIN)
+    ptr = _aligned_malloc(size, alignment);
+#else
+    if (posix_memalign(&ptr, alignment, size) != 0)
+        ptr = NULL;
+#endif
+
+#if defined(Q_OS_LINUX) && defined(MADV_HUGEPAGE)
+    if (ptr != NULL && alignment == HugePageSize)
+        madvise(ptr, size, MADV_HUGEPAGE); // only a hint, transparent hugepages may be disabled
+#endif
+    return reinterpret_cast<unsigned char *>(ptr);
+}
+
+void FrameBufferArena::freeAligned(unsigned char * ptr)
+{
+#if defined(Q_OS_WIN)
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
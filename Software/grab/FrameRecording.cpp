@@ -0,0 +1,250 @@
+/*
+ * FrameRecording.cpp
+ *
+ *  Created on: 18.10.2026
+ *     Project: Lightpack
+ *
+ *  Copyright (c) 2026 Lightpack contributors
+ *
+ *  Lightpack a USB content-driving ambient lighting system
+ *
+ *  Lightpack is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Lightpack is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "FrameRecording.hpp"
+#include <QMutexLocker>
+#include <string.h>
+#include "../src/debug.h"
+
+using namespace FrameRecordingFormat;
+
+FrameRecorder::FrameRecorder()
+    : _recordedFramesCount(0)
+    , _isRecording(0)
+{
+}
+
+FrameRecorder::~FrameRecorder()
+{
+    stop();
+}
+
+bool FrameRecorder::start(const QString &path)
+{
+    QMutexLocker locker(&_mutex);
+
+    stopLocked();
+
+    _file.setFileName(path);
+    if (!_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << Q_FUNC_INFO << "couldn't open" << path << ":" << _file.errorString();
+        return false;
+    }
+
+    FileHeader header;
+    memcpy(header.magic, Magic, sizeof(header.magic));
+    header.version = Version;
+    if (_file.write(reinterpret_cast<const char *>(&header), sizeof(header)) != sizeof(header)) {
+        qWarning() << Q_FUNC_INFO << "couldn't write" << path << ":" << _file.errorString();
+        _file.close();
+        return false;
+    }
+
+    _recordedFramesCount = 0;
+    _lastImages.clear();
+    _isRecording.store(1);
+    DEBUG_LOW_LEVEL << Q_FUNC_INFO << "recording frames to" << path;
+    return true;
+}
+
+void FrameRecorder::stop()
+{
+    QMutexLocker locker(&_mutex);
+    stopLocked();
+}
+
+void FrameRecorder::stopLocked()
+{
+    if (!_file.isOpen())
+        return;
+
+    _isRecording.store(0);
+    _file.close();
+    _lastImages.clear();
+    DEBUG_LOW_LEVEL << Q_FUNC_INFO << _recordedFramesCount << "frames recorded to" << _file.fileName();
+}
+
+void FrameRecorder::record(qint64 timestampNs, const QVector<RecordedScreen> &screens)
+{
+    QMutexLocker locker(&_mutex);
+
+    if (!_file.isOpen())
+        return;
+
+    FrameHeader frameHeader;
+    frameHeader.timestampNs = timestampNs;
+    frameHeader.screensCount = screens.size();
+    frameHeader.reserved = 0;
+    bool isWritten = _file.write(reinterpret_cast<const char *>(&frameHeader), sizeof(frameHeader)) == sizeof(frameHeader);
+
+    _lastImages.resize(screens.size());
+    for (int i = 0; i < screens.size() && isWritten; ++i) {
+        const RecordedScreen &screen = screens[i];
+        const size_t bytesPerLine = screen.bytesPerLine > 0 ? screen.bytesPerLine : screen.rect.width() * 4;
+        const size_t imageSize = qMin(screen.dataSize, bytesPerLine * screen.rect.height());
+
+        QByteArray &lastImage = _lastImages[i];
+        const bool isRepeated = static_cast<size_t>(lastImage.size()) == imageSize
+                && memcmp(lastImage.constData(), screen.data, imageSize) == 0;
+
+        ScreenHeader screenHeader;
+        screenHeader.x = screen.rect.x();
+        screenHeader.y = screen.rect.y();
+        screenHeader.width = screen.rect.width();
+        screenHeader.height = screen.rect.height();
+        screenHeader.format = screen.format;
+        screenHeader.flags = isRepeated ? ScreenRepeated : 0;
+        screenHeader.bytesPerLine = screen.bytesPerLine;
+        screenHeader.reserved = 0;
+        screenHeader.dataSize = isRepeated ? 0 : imageSize;
+
+        isWritten = _file.write(reinterpret_cast<const char *>(&screenHeader), sizeof(screenHeader)) == sizeof(screenHeader);
+        if (isWritten && !isRepeated) {
+            isWritten = _file.write(reinterpret_cast<const char *>(screen.data), imageSize) == static_cast<qint64>(imageSize);
+            // the buffer is reused while screen size stays the same
+            lastImage.resize(imageSize);
+            memcpy(lastImage.data(), screen.data, imageSize);
+        }
+    }
+
+    if (!isWritten) {
+        qWarning() << Q_FUNC_INFO << "couldn't write" << _file.fileName() << ":" << _file.errorString() << ", recording is stopped";
+        stopLocked();
+        return;
+    }
+    ++_recordedFramesCount;
+}
+
+FrameRecording::FrameRecording()
+    : _mapping(NULL)
+{
+}
+
+FrameRecording::~FrameRecording()
+{
+    close();
+}
+
+bool FrameRecording::open(const QString &path)
+{
+    close();
+
+    _file.setFileName(path);
+    if (!_file.open(QIODevice::ReadOnly)) {
+        qWarning() << Q_FUNC_INFO << "couldn't open" << path << ":" << _file.errorString();
+        return false;
+    }
+
+    const qint64 fileSize = _file.size();
+    if (fileSize < static_cast<qint64>(sizeof(FileHeader)) || (_mapping = _file.map(0, fileSize)) == NULL) {
+        qWarning() << Q_FUNC_INFO << "couldn't map" << path;
+        _file.close();
+        return false;
+    }
+
+    const FileHeader *header = reinterpret_cast<const FileHeader *>(_mapping);
+    if (memcmp(header->magic, Magic, sizeof(header->magic)) != 0 || header->version != Version) {
+        qWarning() << Q_FUNC_INFO << path << "is not a frame recording of version" << Version;
+        close();
+        return false;
+    }
+
+    // index frames, a recording cut short by a crash keeps its complete frames.
+    // Sizes are checked against the rest of the file, so a corrupted header ends indexing too
+    qint64 offset = sizeof(FileHeader);
+    while (offset + static_cast<qint64>(sizeof(FrameHeader)) <= fileSize) {
+        const FrameHeader *frameHeader = reinterpret_cast<const FrameHeader *>(_mapping + offset);
+        qint64 frameOffset = offset + sizeof(FrameHeader);
+
+        FrameEntry frame;
+        frame.timestampNs = frameHeader->timestampNs;
+        frame.firstScreen = _screens.size();
+        frame.screensCount = 0;
+
+        const quint64 screensMax = static_cast<quint64>(fileSize - frameOffset) / sizeof(ScreenHeader);
+        bool isComplete = frameHeader->screensCount <= screensMax;
+        if (isComplete)
+            frame.screensCount = frameHeader->screensCount;
+
+        for (int i = 0; i < frame.screensCount && isComplete; ++i) {
+            if (frameOffset + static_cast<qint64>(sizeof(ScreenHeader)) > fileSize) {
+                isComplete = false;
+                break;
+            }
+            const ScreenHeader *screenHeader = reinterpret_cast<const ScreenHeader *>(_mapping + frameOffset);
+            frameOffset += sizeof(ScreenHeader);
+
+            RecordedScreen screen;
+            screen.rect = QRect(screenHeader->x, screenHeader->y, screenHeader->width, screenHeader->height);
+            screen.format = static_cast<BufferFormat>(screenHeader->format);
+            screen.bytesPerLine = screenHeader->bytesPerLine;
+            if (screenHeader->flags & ScreenRepeated) {
+                if (_frames.isEmpty() || i >= _frames.last().screensCount) {
+                    isComplete = false;
+                    break;
+                }
+                const int previousScreen = _frames.last().firstScreen + i;
+                screen.data = _screens[previousScreen].data;
+                screen.dataSize = _screens[previousScreen].dataSize;
+            } else {
+                if (screenHeader->dataSize > static_cast<quint64>(fileSize - frameOffset)) {
+                    isComplete = false;
+                    break;
+                }
+                screen.data = _mapping + frameOffset;
+                screen.dataSize = screenHeader->dataSize;
+                frameOffset += screenHeader->dataSize;
+            }
+            _screens.append(screen);
+        }
+
+        if (!isComplete) {
+            qWarning() << Q_FUNC_INFO << path << "is truncated or corrupted, using" << _frames.size() << "complete frames";
+            _screens.resize(frame.firstScreen);
+            break;
+        }
+        _frames.append(frame);
+        offset = frameOffset;
+    }
+
+    DEBUG_LOW_LEVEL << Q_FUNC_INFO << path << _frames.size() << "frames";
+    return true;
+}
+
+void FrameRecording::close()
+{
+    if (_mapping != NULL)
+        _file.unmap(_mapping);
+    _mapping = NULL;
+    _file.close();
+    _frames.clear();
+    _screens.clear();
+}
+
+QVector<RecordedScreen> FrameRecording::screens(int frameIndex) const
+{
+    const FrameEntry &frame = _frames[frameIndex];
+    return _screens.mid(frame.firstScreen, frame.screensCount);
+}
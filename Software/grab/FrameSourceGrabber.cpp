@@ -0,0 +1,412 @@
+/*
+ * FrameSourceGrabber.cpp
+ *
+ *  Created on: 18.10.2026
+ *     Project: Lightpack
+ *
+ *  Copyright (c) 2026 Lightpack contributors
+ *
+ *  Lightpack a USB content-driving ambient lighting system
+ *
+ *  Lightpack is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Lightpack is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "FrameSourceGrabber.hpp"
+
+#ifdef FRAME_SOURCE_GRAB_SUPPORT
+
+#include <QStringList>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+
+namespace {
+const char ShmPrefix[] = "shm:";
+const int MaxHeaderLineLength = 128;
+// frames read from a pipe in one grab, older ones are dropped to catch up with the writer
+const int MaxPipeFramesPerGrab = 8;
+}
+
+bool FrameSourceGrabber::FrameFormat::isValid() const
+{
+    return width > 0 && height > 0 && width <= FRAMESOURCE_MAX_SIDE && height <= FRAMESOURCE_MAX_SIDE
+            && bytesPerLine >= width * 4 && format != BufferFormatUnknown && format != BufferFormatRgbg;
+}
+
+FrameSourceGrabber::FrameSourceGrabber(QObject *parent, GrabberContext *context)
+    : TimeredGrabber(parent, context)
+    , _sourceType(NoSource)
+    , _fd(-1)
+    , _frame(NULL)
+    , _isFrameUpdated(false)
+    , _isHeaderRead(false)
+    , _frontBuffer(0)
+    , _backBufferFilled(0)
+    , _shm(NULL)
+    , _shmSize(0)
+    , _slotsCount(0)
+    , _dataOffset(0)
+    , _slotSize(0)
+    , _lastSequence(0)
+{
+}
+
+FrameSourceGrabber::~FrameSourceGrabber()
+{
+    closeSource();
+}
+
+bool FrameSourceGrabber::openSource(const QString &source)
+{
+    DEBUG_LOW_LEVEL << Q_FUNC_INFO << source;
+
+    closeSource();
+    _source = source;
+
+    if (source.startsWith(ShmPrefix)) {
+        _sourceType = ShmSource;
+        // producer may create the object later, it is mapped on the first grab then
+        if (!mapShm())
+            DEBUG_LOW_LEVEL << Q_FUNC_INFO << "shared memory isn't ready yet:" << source;
+        return true;
+    }
+
+    // nonblocking, so opening doesn't wait for a writer and reads never stall the grabbers thread
+    _fd = open(source.toLocal8Bit().constData(), O_RDONLY | O_NONBLOCK);
+    if (_fd < 0) {
+        qWarning() << Q_FUNC_INFO << "couldn't open" << source << ":" << strerror(errno);
+        return false;
+    }
+    _sourceType = PipeSource;
+    return true;
+}
+
+void FrameSourceGrabber::setOrigin(const QPoint &origin)
+{
+    _origin = origin;
+}
+
+void FrameSourceGrabber::closeSource()
+{
+    if (_fd >= 0)
+        close(_fd);
+    _fd = -1;
+    unmapShm();
+    freePipeBuffers();
+    _sourceType = NoSource;
+    _format = FrameFormat();
+    _frame = NULL;
+    _isFrameUpdated = false;
+    _headerLine.clear();
+    _isHeaderRead = false;
+}
+
+QList<ScreenInfo> * FrameSourceGrabber::screensWithWidgets(QList<ScreenInfo> *result, const QList<GrabZone> &grabZones)
+{
+    // polled before screens are resolved, so a format change reallocates within the same grab
+    pollSource();
+
+    result->clear();
+    if (_frame == NULL)
+        return result;
+
+    ScreenInfo screen;
+    screen.rect = QRect(_origin, QSize(_format.width, _format.height));
+    for (int i = 0; i < grabZones.size(); ++i) {
+        if (screen.rect.intersects(grabZones[i].rect)) {
+            result->append(screen);
+            break;
+        }
+    }
+    return result;
+}
+
+bool FrameSourceGrabber::reallocate(const QList<ScreenInfo> &screens)
+{
+    _screensWithWidgets.clear();
+    for (int i = 0; i < screens.size(); ++i) {
+        GrabbedScreen grabScreen;
+        grabScreen.imgData = NULL;
+        grabScreen.imgDataSize = 0;
+        grabScreen.screenInfo = screens[i];
+        _screensWithWidgets.append(grabScreen);
+    }
+    return true;
+}
+
+GrabResult FrameSourceGrabber::grabScreens()
+{
+    if (_frame == NULL || _screensWithWidgets.isEmpty())
+        return GrabResultFrameNotReady;
+    if (!_isFrameUpdated)
+        return GrabResultFrameUnchanged;
+
+    _isFrameUpdated = false;
+    GrabbedScreen &screen = _screensWithWidgets[0];
+    // shared memory is mapped read only, frames are never written through this pointer
+    screen.imgData = const_cast<unsigned char *>(_frame);
+    screen.imgDataSize = _format.frameSize();
+    screen.imgFormat = _format.format;
+    screen.bytesPerLine = _format.bytesPerLine;
+    return GrabResultOk;
+}
+
+void FrameSourceGrabber::pollSource()
+{
+    switch (_sourceType) {
+    case PipeSource:
+        readPipe();
+        break;
+    case ShmSource:
+        pollShm();
+        break;
+    default:
+        break;
+    }
+}
+
+void FrameSourceGrabber::readPipe()
+{
+    for (int framesRead = 0; framesRead < MaxPipeFramesPerGrab; ) {
+        if (!_isHeaderRead && !readPipeHeader())
+            return;
+
+        unsigned char *back = _pipeBuffers[1 - _frontBuffer].ptr;
+        const size_t frameSize = _format.frameSize();
+        const ssize_t bytesRead = read(_fd, back + _backBufferFilled, frameSize - _backBufferFilled);
+        if (bytesRead > 0) {
+            _backBufferFilled += bytesRead;
+            if (_backBufferFilled == frameSize) {
+                _frontBuffer = 1 - _frontBuffer;
+                _backBufferFilled = 0;
+                _frame = _pipeBuffers[_frontBuffer].ptr;
+                _isFrameUpdated = true;
+                ++framesRead;
+            }
+        } else if (bytesRead == 0) {
+            // writer has gone, the next one starts with a header again
+            _isHeaderRead = false;
+            _backBufferFilled = 0;
+            return;
+        } else if (errno != EINTR) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                qWarning() << Q_FUNC_INFO << "couldn't read" << _source << ":" << strerror(errno);
+            return;
+        }
+    }
+}
+
+bool FrameSourceGrabber::readPipeHeader()
+{
+    char c;
+    ssize_t bytesRead;
+    while ((bytesRead = read(_fd, &c, 1)) == 1) {
+        if (c != '\n') {
+            _headerLine.append(c);
+            if (_headerLine.size() > MaxHeaderLineLength) {
+                qWarning() << Q_FUNC_INFO << _source << "header is too long, waiting for the next writer";
+                _headerLine.clear();
+            }
+            continue;
+        }
+
+        const QStringList fields = QString::fromLatin1(_headerLine).simplified().split(' ');
+        _headerLine.clear();
+
+        FrameFormat format;
+        if (fields.size() == 5 && fields[0] == FRAMESOURCE_MAGIC) {
+            format.width = fields[1].toInt();
+            format.height = fields[2].toInt();
+            format.bytesPerLine = fields[3].toInt();
+            // names are byte orders as of ffmpeg pixel formats, BufferFormat names 32-bit little endian words
+            const QString formatName = fields[4].toLower();
+            if (formatName == "bgra")
+                format.format = BufferFormatArgb;
+            else if (formatName == "rgba")
+                format.format = BufferFormatAbgr;
+            else if (formatName == "argb")
+                format.format = BufferFormatBgra;
+            else if (formatName == "abgr")
+                format.format = BufferFormatRgba;
+        }
+        if (!format.isValid()) {
+            qWarning() << Q_FUNC_INFO << _source << "unsupported header:" << fields.join(" ");
+            continue;
+        }
+
+        setPipeFormat(format);
+        _isHeaderRead = _pipeBuffers[0].ptr != NULL;
+        return _isHeaderRead;
+    }
+    if (bytesRead < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+        qWarning() << Q_FUNC_INFO << "couldn't read" << _source << ":" << strerror(errno);
+    return false;
+}
+
+void FrameSourceGrabber::setPipeFormat(const FrameFormat &format)
+{
+    _backBufferFilled = 0;
+    if (!(format != _format) && _pipeBuffers[0].ptr != NULL)
+        return;
+
+    DEBUG_LOW_LEVEL << Q_FUNC_INFO << format.width << "x" << format.height << "bytes per line:" << format.bytesPerLine << "format:" << format.format;
+    freePipeBuffers();
+    _format = format;
+    for (int i = 0; i < 2; ++i) {
+        _pipeBuffers[i] = _context->bufferArena.acquire(format.frameSize());
+        if (_pipeBuffers[i].isNull()) {
+            qCritical() << Q_FUNC_INFO << "couldn't allocate" << format.frameSize() << "bytes";
+            freePipeBuffers();
+            return;
+        }
+    }
+}
+
+void FrameSourceGrabber::freePipeBuffers()
+{
+    for (int i = 0; i < 2; ++i) {
+        if (!_pipeBuffers[i].isNull())
+            _context->bufferArena.release(_pipeBuffers[i]);
+        _pipeBuffers[i] = FrameBuffer();
+    }
+    _frame = NULL;
+    _frontBuffer = 0;
+    _backBufferFilled = 0;
+}
+
+bool FrameSourceGrabber::mapShm()
+{
+    const QByteArray name = _source.mid(sizeof(ShmPrefix) - 1).toLocal8Bit();
+    const int fd = shm_open(name.constData(), O_RDONLY, 0);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(FRAMESOURCE_SHM_HEADER)) {
+        close(fd);
+        return false;
+    }
+
+    void *mapping = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+        return false;
+
+    // the producer may rewrite the header meanwhile, so every field is read once
+    const volatile FRAMESOURCE_SHM_HEADER *header = reinterpret_cast<const volatile FRAMESOURCE_SHM_HEADER *>(mapping);
+    const bool isMagicValid = header->magic[0] == FRAMESOURCE_MAGIC[0] && header->magic[1] == FRAMESOURCE_MAGIC[1]
+            && header->magic[2] == FRAMESOURCE_MAGIC[2] && header->magic[3] == FRAMESOURCE_MAGIC[3];
+    const quint32 version = header->version;
+    FrameFormat format;
+    format.width = header->width;
+    format.height = header->height;
+    format.bytesPerLine = header->bytesPerLine;
+    format.format = static_cast<BufferFormat>(header->format);
+    const quint32 slotsCount = header->slotsCount;
+    const quint64 dataOffset = header->dataOffset;
+    const quint64 slotSize = header->slotSize;
+
+    const bool isValid = isMagicValid
+            && version == FRAMESOURCE_VERSION
+            && format.isValid()
+            && slotsCount >= 2
+            && slotSize >= format.frameSize()
+            && dataOffset >= sizeof(FRAMESOURCE_SHM_HEADER)
+            && dataOffset <= static_cast<quint64>(st.st_size)
+            // divided, slotsCount * slotSize may overflow
+            && slotSize <= (static_cast<quint64>(st.st_size) - dataOffset) / slotsCount;
+    if (!isValid) {
+        qWarning() << Q_FUNC_INFO << _source << "has unsupported header";
+        munmap(mapping, st.st_size);
+        return false;
+    }
+
+    DEBUG_LOW_LEVEL << Q_FUNC_INFO << _source << format.width << "x" << format.height << "slots:" << slotsCount;
+    _shm = static_cast<unsigned char *>(mapping);
+    _shmSize = st.st_size;
+    _format = format;
+    _slotsCount = slotsCount;
+    _dataOffset = dataOffset;
+    _slotSize = slotSize;
+    _lastSequence = 0;
+    return true;
+}
+
+void FrameSourceGrabber::unmapShm()
+{
+    if (_shm != NULL)
+        munmap(_shm, _shmSize);
+    _shm = NULL;
+    _shmSize = 0;
+    _slotsCount = 0;
+    _dataOffset = 0;
+    _slotSize = 0;
+    _lastSequence = 0;
+}
+
+/*!
+  Compares the header with the layout validated by mapShm(), the producer recreated the
+  ring in place if they differ
+*/
+bool FrameSourceGrabber::isShmLayoutChanged() const
+{
+    const volatile FRAMESOURCE_SHM_HEADER *header = reinterpret_cast<const volatile FRAMESOURCE_SHM_HEADER *>(_shm);
+    return static_cast<int>(header->width) != _format.width || static_cast<int>(header->height) != _format.height
+            || static_cast<int>(header->bytesPerLine) != _format.bytesPerLine || header->format != _format.format
+            || header->slotsCount != _slotsCount || header->dataOffset != _dataOffset || header->slotSize != _slotSize;
+}
+
+void FrameSourceGrabber::pollShm()
+{
+    if (_shm == NULL && !mapShm())
+        return;
+
+    if (isShmLayoutChanged()) {
+        unmapShm();
+        _frame = NULL;
+        if (!mapShm())
+            return;
+    }
+
+    const FRAMESOURCE_SHM_HEADER *header = reinterpret_cast<const FRAMESOURCE_SHM_HEADER *>(_shm);
+    const quint64 sequence = __atomic_load_n(&header->writeSequence, __ATOMIC_ACQUIRE);
+    if (sequence == 0 || sequence == _lastSequence)
+        return;
+
+    _lastSequence = sequence;
+    // only the validated layout is used, the header may change again after the check
+    _frame = _shm + _dataOffset + ((sequence - 1) % _slotsCount) * _slotSize;
+    _isFrameUpdated = true;
+}
+
+/*!
+  Frames are averaged straight from the ring. Producer starts overwriting the slot of frame N
+  after it publishes frame N + slotsCount - 1, the frame is dropped if that happened meanwhile
+  or if the ring was recreated in place.
+*/
+bool FrameSourceGrabber::isGrabbedFrameIntact() const
+{
+    if (_sourceType != ShmSource || _shm == NULL)
+        return true;
+
+    const FRAMESOURCE_SHM_HEADER *header = reinterpret_cast<const FRAMESOURCE_SHM_HEADER *>(_shm);
+    const quint64 sequence = __atomic_load_n(&header->writeSequence, __ATOMIC_ACQUIRE);
+    return sequence - _lastSequence < _slotsCount - 1 && !isShmLayoutChanged();
+}
+
+#endif // FRAME_SOURCE_GRAB_SUPPORT
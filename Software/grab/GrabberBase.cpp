@@ -24,6 +24,7 @@
  */
 
 #include "GrabberBase.hpp"
+#include <QElapsedTimer>
 #include "../src/debug.h"
 
 int validCoord(int a) {
@@ -44,19 +45,37 @@ inline QRect & getValidRect(QRect & rect) {
 
 GrabberBase::GrabberBase(QObject *parent, GrabberContext *grabberContext) : QObject(parent) {
     _context = grabberContext;
+    _skippedFramesCount.store(0);
+    _grabZonesGeneration = -1;
+    _isZoneMapDirty = true;
+}
+
+QRect GrabberBase::grabRectOfWidget(const GrabWidget *widget) {
+    QRect widgetRect = widget->frameGeometry();
+    return getValidRect(widgetRect);
+}
+
+QRect GrabberBase::grabRectOfGeometry(const QRect &geometry) {
+    QRect rect = geometry;
+    return getValidRect(rect);
 }
 
 const GrabbedScreen * GrabberBase::screenOfRect(const QRect &rect) const {
+    int screenIndex = screenIndexOfRect(rect);
+    return screenIndex < 0 ? NULL : &_screensWithWidgets[screenIndex];
+}
+
+int GrabberBase::screenIndexOfRect(const QRect &rect) const {
     QPoint center = rect.center();
     for (int i = 0; i < _screensWithWidgets.size(); ++i) {
         if (_screensWithWidgets[i].screenInfo.rect.contains(center))
-            return &_screensWithWidgets[i];
+            return i;
     }
     for (int i = 0; i < _screensWithWidgets.size(); ++i) {
         if (_screensWithWidgets[i].screenInfo.rect.intersects(rect))
-            return &_screensWithWidgets[i];
+            return i;
     }
-    return NULL;
+    return -1;
 }
 
 bool GrabberBase::isReallocationNeeded(const QList< ScreenInfo > &screensWithWidgets) const  {
@@ -70,71 +89,148 @@ bool GrabberBase::isReallocationNeeded(const QList< ScreenInfo > &screensWithWid
     return false;
 }
 
+void GrabberBase::buildZoneMap() {
+    const int screensCount = _screensWithWidgets.size();
+    _zoneMap.resize(_grabZones.size());
+    _screenZones.resize(screensCount);
+    _screenZoneWidgets.resize(screensCount);
+    for (int s = 0; s < screensCount; ++s) {
+        _screenZones[s].clear();
+        _screenZoneWidgets[s].clear();
+    }
+
+    for (int i = 0; i < _grabZones.size(); ++i) {
+        const QRect &widgetRect = _grabZones[i].rect;
+        ZoneMapEntry &entry = _zoneMap[i];
+        entry.screenIndex = screenIndexOfRect(widgetRect);
+        entry.isEnabled = false;
+
+        if (entry.screenIndex < 0) {
+            DEBUG_HIGH_LEVEL << Q_FUNC_INFO << " widget is out of screen " << Debug::toString(widgetRect);
+            continue;
+        }
+        DEBUG_HIGH_LEVEL << Q_FUNC_INFO << Debug::toString(widgetRect);
+        QRect monitorRect = _screensWithWidgets[entry.screenIndex].screenInfo.rect;
+
+        QRect clippedRect = monitorRect.intersected(widgetRect);
+
+        // Checking for the 'grabme' widget position inside the monitor that is used to capture color
+        if( !clippedRect.isValid() ){
+            DEBUG_MID_LEVEL << "Widget 'grabme' is out of screen:" << Debug::toString(clippedRect);
+            continue;
+        }
+
+        // Convert coordinates from "Main" desktop coord-system to capture-monitor coord-system
+        QRect preparedRect = clippedRect.translated(-monitorRect.x(), -monitorRect.y());
+
+        // Align width by 4 for accelerated calculations
+        preparedRect.setWidth(preparedRect.width() - (preparedRect.width() % 4));
+
+        if( !preparedRect.isValid() ){
+            qWarning() << Q_FUNC_INFO << " preparedRect is not valid:" << Debug::toString(preparedRect);
+            // width and height can't be negative
+            continue;
+        }
+
+        entry.rect = preparedRect;
+        entry.isEnabled = _grabZones[i].isAreaEnabled;
+        if (entry.isEnabled) {
+            _screenZones[entry.screenIndex].append(preparedRect);
+            _screenZoneWidgets[entry.screenIndex].append(i);
+        }
+    }
+    _isZoneMapDirty = false;
+}
+
+void GrabberBase::recordScreens(qint64 timestampNs) {
+    QVector<RecordedScreen> screens(_screensWithWidgets.size());
+    for (int i = 0; i < _screensWithWidgets.size(); ++i) {
+        screens[i].rect = _screensWithWidgets[i].screenInfo.rect;
+        screens[i].format = _screensWithWidgets[i].imgFormat;
+        screens[i].bytesPerLine = _screensWithWidgets[i].bytesPerLine;
+        screens[i].data = _screensWithWidgets[i].imgData;
+        screens[i].dataSize = _screensWithWidgets[i].imgDataSize;
+    }
+    _context->frameRecorder.record(timestampNs, screens);
+}
+
 void GrabberBase::grab() {
     DEBUG_MID_LEVEL << Q_FUNC_INFO << this->metaObject()->className();
     QList< ScreenInfo > screens2Grab;
     screens2Grab.reserve(5);
-    screensWithWidgets(&screens2Grab, *_context->grabWidgets);
+    // zones are copied only when GrabManager publishes changed widgets
+    if (_context->grabZonesGeneration() != _grabZonesGeneration) {
+        _grabZones = _context->grabZones(&_grabZonesGeneration);
+        _isZoneMapDirty = true;
+    }
+    screensWithWidgets(&screens2Grab, _grabZones);
     if (isReallocationNeeded(screens2Grab)) {
         if (!reallocate(screens2Grab)) {
             qCritical() << Q_FUNC_INFO << " couldn't reallocate grabbing buffer";
             emit frameGrabAttempted(GrabResultError);
             return;
         }
+        _isZoneMapDirty = true;
     }
+    QElapsedTimer stageTimer;
+    stageTimer.start();
     _lastGrabResult = grabScreens();
+    const qint64 captureNs = stageTimer.nsecsElapsed();
+    if (_lastGrabResult == GrabResultFrameUnchanged)
+        _skippedFramesCount.ref();
     if (_lastGrabResult == GrabResultOk) {
-        _context->grabResult->clear();
-
-        for (int i = 0; i < _context->grabWidgets->size(); ++i) {
-            QRect widgetRect = _context->grabWidgets->at(i)->frameGeometry();
-            getValidRect(widgetRect);
-
-            const GrabbedScreen *grabbedScreen = screenOfRect(widgetRect);
-            if (grabbedScreen == NULL) {
-                DEBUG_HIGH_LEVEL << Q_FUNC_INFO << " widget is out of screen " << Debug::toString(widgetRect);
-                _context->grabResult->append(0);
+        stageTimer.restart();
+
+        const bool isZoneMapRebuilt = _isZoneMapDirty;
+        if (_isZoneMapDirty)
+            buildZoneMap();
+
+        GrabbedFrame &frame = _context->grabResult.writeBuffer();
+        QList<QRgb> &grabResult = frame.colors;
+        grabResult.clear();
+        grabResult.reserve(_zoneMap.size());
+        for (int i = 0; i < _zoneMap.size(); ++i)
+            grabResult.append(_zoneMap[i].screenIndex < 0 ? 0 : qRgb(0,0,0));
+
+        using namespace Grab;
+        const int bytesPerPixel = 4;
+        const int screensCount = _screensWithWidgets.size();
+        _scanlinePlans.resize(screensCount);
+        _integralImages.resize(screensCount);
+        const int subsamplingStep = _context->subsamplingStep.load();
+        for (int s = 0; s < screensCount; ++s) {
+            if (_screenZones[s].isEmpty())
                 continue;
-            }
-            DEBUG_HIGH_LEVEL << Q_FUNC_INFO << Debug::toString(widgetRect);
-            QRect monitorRect = grabbedScreen->screenInfo.rect;
-
-            QRect clippedRect = monitorRect.intersected(widgetRect);
-
-            // Checking for the 'grabme' widget position inside the monitor that is used to capture color
-            if( !clippedRect.isValid() ){
 
-                DEBUG_MID_LEVEL << "Widget 'grabme' is out of screen:" << Debug::toString(clippedRect);
+            Calculations::ScanlinePlan &plan = _scanlinePlans[s];
+            if (isZoneMapRebuilt || plan.step != subsamplingStep)
+                Calculations::buildScanlinePlan(&plan, _screenZones[s], subsamplingStep);
 
-                _context->grabResult->append(qRgb(0,0,0));
+            const GrabbedScreen &grabbedScreen = _screensWithWidgets[s];
+            const int pitch = grabbedScreen.bytesPerLine > 0 ? grabbedScreen.bytesPerLine : grabbedScreen.screenInfo.rect.width() * bytesPerPixel;
+            if (!Calculations::calculateAvgColors(&_zoneColors, grabbedScreen.imgData, grabbedScreen.imgFormat, pitch, plan, &_integralImages[s]))
                 continue;
-            }
-
-            // Convert coordinates from "Main" desktop coord-system to capture-monitor coord-system
-            QRect preparedRect = clippedRect.translated(-monitorRect.x(), -monitorRect.y());
-
-            // Align width by 4 for accelerated calculations
-            preparedRect.setWidth(preparedRect.width() - (preparedRect.width() % 4));
 
-            if( !preparedRect.isValid() ){
-                qWarning() << Q_FUNC_INFO << " preparedRect is not valid:" << Debug::toString(preparedRect);
-                // width and height can't be negative
+            for (int j = 0; j < _screenZoneWidgets[s].size(); ++j)
+                grabResult[_screenZoneWidgets[s][j]] = _zoneColors[j];
+        }
 
-                _context->grabResult->append(qRgb(0,0,0));
-                continue;
-            }
-
-            using namespace Grab;
-            const int bytesPerPixel = 4;
-            QRgb avgColor;
-            if (_context->grabWidgets->at(i)->isAreaEnabled()) {
-                Calculations::calculateAvgColor(&avgColor, grabbedScreen->imgData, grabbedScreen->imgFormat, grabbedScreen->screenInfo.rect.width() * bytesPerPixel, preparedRect );
-                _context->grabResult->append(avgColor);
-            } else {
-                _context->grabResult->append(qRgb(0,0,0));
-            }
+        if (!isGrabbedFrameIntact()) {
+            DEBUG_MID_LEVEL << Q_FUNC_INFO << "frame was overwritten while it was averaged, dropped";
+            _lastGrabResult = GrabResultFrameNotReady;
+            emit frameGrabAttempted(_lastGrabResult);
+            return;
         }
 
+        frame.frameId = _context->nextFrameId();
+        frame.captureNs = captureNs;
+        frame.computeNs = stageTimer.nsecsElapsed();
+        frame.publishedNs = _context->clock.nsecsElapsed();
+        const qint64 capturedNs = frame.publishedNs - frame.computeNs;
+        _context->grabResult.publish();
+
+        if (_context->frameRecorder.isRecording())
+            recordScreens(capturedNs);
     }
     emit frameGrabAttempted(_lastGrabResult);
 }
@@ -48,8 +48,12 @@ void MacOSGrabber::freeScreens()
 {
     for (int i = 0; i < _screensWithWidgets.size(); ++i) {
         GrabbedScreen screen = _screensWithWidgets[i];
-        if (screen.imgData != NULL)
-            free(screen.imgData);
+        if (screen.imgData != NULL) {
+            FrameBuffer buffer;
+            buffer.ptr = screen.imgData;
+            buffer.size = screen.imgDataSize;
+            _context->bufferArena.release(buffer);
+        }
 
         if (screen.associatedData != NULL)
             free(screen.associatedData);
@@ -57,7 +61,7 @@ void MacOSGrabber::freeScreens()
     _screensWithWidgets.clear();
 }
 
-QList< ScreenInfo > * MacOSGrabber::screensWithWidgets(QList< ScreenInfo > * result, const QList<GrabWidget *> &grabWidgets)
+QList< ScreenInfo > * MacOSGrabber::screensWithWidgets(QList< ScreenInfo > * result, const QList<GrabZone> &grabZones)
 {
     CGDirectDisplayID displays[kMaxDisplaysCount];
     uint32_t displayCount;
@@ -69,8 +73,8 @@ QList< ScreenInfo > * MacOSGrabber::screensWithWidgets(QList< ScreenInfo > * res
     if (err == kCGErrorSuccess) {
         for (unsigned int i = 0; i < displayCount; ++i) {
             CGRect cgScreenRect = CGDisplayBounds(displays[i]);
-            for (int k = 0; k < grabWidgets.size(); ++k) {
-                QRect rect = grabWidgets[i]->frameGeometry();
+            for (int k = 0; k < grabZones.size(); ++k) {
+                const QRect &rect = grabZones[k].rect;
                 CGPoint widgetCenter = CGPointMake(rect.x() + rect.width() / 2, rect.y() + rect.height() / 2);
                 if (CGRectContainsPoint(cgScreenRect, widgetCenter)) {
                     ScreenInfo screenInfo;
@@ -133,14 +137,15 @@ bool MacOSGrabber::reallocate(const QList<ScreenInfo> &screens)
         DEBUG_HIGH_LEVEL << "dimensions " << width << "x" << height << screens[i].handle;
 
         size_t imgSize = height * width * kBytesPerPixel;
-        unsigned char *buf = reinterpret_cast<unsigned char*>(calloc(imgSize, sizeof(unsigned char)));
-        if (buf == NULL) {
+        FrameBuffer buffer = _context->bufferArena.acquire(imgSize);
+        if (buffer.isNull()) {
             qCritical() << "couldn't allocate image buffer";
             freeScreens();
             return false;
         }
         GrabbedScreen grabScreen;
-        grabScreen.imgData = buf;
+        grabScreen.imgData = buffer.ptr;
+        grabScreen.imgDataSize = imgSize;
         grabScreen.imgFormat = BufferFormatArgb;
         grabScreen.screenInfo = screens[i];
         //grabScreen.associatedData = d;
@@ -0,0 +1,176 @@
+/*
+ * ReplayGrabber.cpp
+ *
+ *  Created on: 18.10.2026
+ *     Project: Lightpack
+ *
+ *  Copyright (c) 2026 Lightpack contributors
+ *
+ *  Lightpack a USB content-driving ambient lighting system
+ *
+ *  Lightpack is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Lightpack is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "ReplayGrabber.hpp"
+#include <QTimer>
+#include "../src/debug.h"
+
+namespace {
+const qint64 NsPerMs = 1000 * 1000;
+}
+
+ReplayGrabber::ReplayGrabber(QObject *parent, GrabberContext *context)
+    : GrabberBase(parent, context)
+    , m_frameIndex(0)
+    , m_isRealtime(true)
+    , m_isStarted(false)
+{
+    m_timer.reset(new QTimer(this));
+    m_timer->setTimerType(Qt::PreciseTimer);
+    m_timer->setSingleShot(true);
+    connect(m_timer.data(), SIGNAL(timeout()), this, SLOT(onFrameDue()));
+}
+
+ReplayGrabber::~ReplayGrabber()
+{
+}
+
+bool ReplayGrabber::openRecording(const QString &path)
+{
+    DEBUG_LOW_LEVEL << Q_FUNC_INFO << path;
+
+    m_timer->stop();
+    _screensWithWidgets.clear();
+    m_frameIndex = 0;
+
+    const bool isOpened = m_recording.open(path) && m_recording.framesCount() > 0;
+    if (!isOpened)
+        qWarning() << Q_FUNC_INFO << "nothing to replay in" << path;
+
+    if (m_isStarted)
+        startGrabbing();
+    return isOpened;
+}
+
+void ReplayGrabber::setRealtime(bool isRealtime)
+{
+    m_isRealtime = isRealtime;
+}
+
+void ReplayGrabber::startGrabbing()
+{
+    DEBUG_LOW_LEVEL << Q_FUNC_INFO << this->metaObject()->className();
+    m_isStarted = true;
+    m_frameIndex = 0;
+    m_passTimer.start();
+    scheduleFrame();
+}
+
+void ReplayGrabber::stopGrabbing()
+{
+    DEBUG_LOW_LEVEL << Q_FUNC_INFO << this->metaObject()->className();
+    m_isStarted = false;
+    m_timer->stop();
+}
+
+bool ReplayGrabber::isGrabbingStarted() const
+{
+    return m_isStarted;
+}
+
+void ReplayGrabber::setGrabInterval(int msec)
+{
+    Q_UNUSED(msec);
+}
+
+void ReplayGrabber::scheduleFrame()
+{
+    if (!m_isStarted || m_recording.framesCount() == 0)
+        return;
+
+    qint64 delayMs = 0;
+    if (m_isRealtime) {
+        const qint64 dueNs = m_recording.timestampNs(m_frameIndex) - m_recording.timestampNs(0);
+        delayMs = qMax(Q_INT64_C(0), (dueNs - m_passTimer.nsecsElapsed()) / NsPerMs);
+    }
+    m_timer->start(static_cast<int>(delayMs));
+}
+
+void ReplayGrabber::onFrameDue()
+{
+    grab();
+
+    if (++m_frameIndex >= m_recording.framesCount()) {
+        DEBUG_LOW_LEVEL << Q_FUNC_INFO << "replayed" << m_frameIndex << "frames in" << m_passTimer.elapsed() << "ms";
+        m_frameIndex = 0;
+        m_passTimer.restart();
+    }
+    scheduleFrame();
+}
+
+QList<ScreenInfo> * ReplayGrabber::screensWithWidgets(QList<ScreenInfo> *result, const QList<GrabZone> &grabZones)
+{
+    Q_UNUSED(grabZones);
+    result->clear();
+    if (m_recording.framesCount() == 0)
+        return result;
+
+    // zones out of recorded screens are left black by the zone map
+    const QVector<RecordedScreen> screens = m_recording.screens(m_frameIndex);
+    for (int i = 0; i < screens.size(); ++i) {
+        ScreenInfo screenInfo;
+        screenInfo.rect = screens[i].rect;
+        result->append(screenInfo);
+    }
+    return result;
+}
+
+bool ReplayGrabber::reallocate(const QList<ScreenInfo> &screens)
+{
+    _screensWithWidgets.clear();
+    for (int i = 0; i < screens.size(); ++i) {
+        GrabbedScreen grabScreen;
+        grabScreen.imgData = NULL;
+        grabScreen.imgDataSize = 0;
+        grabScreen.screenInfo = screens[i];
+        _screensWithWidgets.append(grabScreen);
+    }
+    return true;
+}
+
+GrabResult ReplayGrabber::grabScreens()
+{
+    if (m_recording.framesCount() == 0)
+        return GrabResultFrameNotReady;
+
+    const QVector<RecordedScreen> screens = m_recording.screens(m_frameIndex);
+    if (screens.size() != _screensWithWidgets.size())
+        return GrabResultError;
+
+    for (int i = 0; i < screens.size(); ++i) {
+        const size_t bytesPerLine = screens[i].bytesPerLine > 0 ? screens[i].bytesPerLine : screens[i].rect.width() * 4;
+        const size_t expectedSize = bytesPerLine * screens[i].rect.height();
+        if (screens[i].dataSize < expectedSize) {
+            qWarning() << Q_FUNC_INFO << "frame" << m_frameIndex << "screen" << i << "image is too small";
+            return GrabResultError;
+        }
+        // images are only read, the mapping is read only
+        _screensWithWidgets[i].imgData = const_cast<unsigned char *>(screens[i].data);
+        _screensWithWidgets[i].imgDataSize = screens[i].dataSize;
+        _screensWithWidgets[i].imgFormat = screens[i].format;
+        _screensWithWidgets[i].bytesPerLine = screens[i].bytesPerLine;
+    }
+    return GrabResultOk;
+}
@@ -27,29 +27,166 @@
 #include "TimeredGrabber.hpp"
 
 #include <QTimer>
+#include <QSocketNotifier>
+#include <QElapsedTimer>
+
+#ifdef Q_OS_LINUX
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#endif
+
+namespace {
+const qint64 NsPerMs  = 1000000;
+const qint64 NsPerSec = 1000000000;
+}
 
 TimeredGrabber::TimeredGrabber(QObject * parent, GrabberContext *context)
-    : GrabberBase(parent, context) {
-    if (m_timer && m_timer->isActive())
-        m_timer->stop();
+    : GrabberBase(parent, context)
+    , m_timerFd(-1)
+    , m_isStarted(false)
+    , m_intervalNs(40 * NsPerMs)
+    , m_deadlineNs(0)
+    , m_missedDeadlinesCount(0)
+{
+#ifdef Q_OS_LINUX
+    m_timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (m_timerFd != -1) {
+        m_timerNotifier.reset(new QSocketNotifier(m_timerFd, QSocketNotifier::Read, this));
+        connect(m_timerNotifier.data(), SIGNAL(activated(int)), this, SLOT(onDeadline()));
+        return;
+    }
+    qWarning() << Q_FUNC_INFO << "timerfd_create failed:" << strerror(errno) << ", falling back to QTimer";
+#endif
     m_timer.reset(new QTimer(this));
-    connect(m_timer.data(), SIGNAL(timeout()), this, SLOT(grab()));
+    m_timer->setTimerType(Qt::PreciseTimer);
+    m_timer->setSingleShot(true);
+    connect(m_timer.data(), SIGNAL(timeout()), this, SLOT(onDeadline()));
+}
+
+TimeredGrabber::~TimeredGrabber() {
+#ifdef Q_OS_LINUX
+    m_timerNotifier.reset();
+    if (m_timerFd != -1)
+        close(m_timerFd);
+#endif
 }
 
 void TimeredGrabber::setGrabInterval(int msec) {
-    DEBUG_LOW_LEVEL << Q_FUNC_INFO <<  this->metaObject()->className();
-    m_timer->setInterval(msec);
+    DEBUG_LOW_LEVEL << Q_FUNC_INFO <<  this->metaObject()->className() << msec;
+    setGrabIntervalNs(msec * NsPerMs);
+}
+
+void TimeredGrabber::setGrabFps(double fps) {
+    DEBUG_LOW_LEVEL << Q_FUNC_INFO <<  this->metaObject()->className() << fps;
+    if (fps <= 0) {
+        qWarning() << Q_FUNC_INFO << "invalid fps:" << fps;
+        return;
+    }
+    setGrabIntervalNs(static_cast<qint64>(NsPerSec / fps));
+}
+
+void TimeredGrabber::setGrabIntervalNs(qint64 intervalNs) {
+    // zero interval means as fast as possible, like QTimer with zero interval
+    m_intervalNs = qMax(intervalNs, qint64(0));
+    if (m_isStarted) {
+        m_deadlineNs = monotonicNs() + m_intervalNs;
+        armTimer();
+    }
 }
+
 void TimeredGrabber::startGrabbing() {
     DEBUG_LOW_LEVEL << Q_FUNC_INFO << this->metaObject()->className();
-    m_timer->start();
+    m_isStarted = true;
+    m_deadlineNs = monotonicNs() + m_intervalNs;
+    armTimer();
 }
+
 void TimeredGrabber::stopGrabbing() {
     DEBUG_LOW_LEVEL << Q_FUNC_INFO << this->metaObject()->className();
-    m_timer->stop();
+    m_isStarted = false;
+    disarmTimer();
 }
 
 bool TimeredGrabber::isGrabbingStarted() const {
     DEBUG_LOW_LEVEL << Q_FUNC_INFO << this->metaObject()->className();
-    return m_timer->isActive();
+    return m_isStarted;
+}
+
+void TimeredGrabber::onDeadline() {
+#ifdef Q_OS_LINUX
+    if (m_timerFd != -1) {
+        quint64 expirations;
+        if (read(m_timerFd, &expirations, sizeof(expirations)) != sizeof(expirations))
+            return; // spurious wakeup or timer was rearmed
+    }
+#endif
+    if (!m_isStarted)
+        return;
+
+    grab();
+
+    // grab() may stop grabbing through a direct connection
+    if (!m_isStarted)
+        return;
+
+    // next deadline is counted from the previous one, not from the end of grab()
+    m_deadlineNs += m_intervalNs;
+    const qint64 now = monotonicNs();
+    if (now >= m_deadlineNs) {
+        const qint64 missed = m_intervalNs > 0 ? (now - m_deadlineNs) / m_intervalNs + 1 : 0;
+        if (missed > 0) {
+            m_missedDeadlinesCount.fetchAndAddRelaxed(static_cast<int>(missed));
+            DEBUG_HIGH_LEVEL << Q_FUNC_INFO << "skipping" << missed << "frames";
+        }
+        m_deadlineNs += missed * m_intervalNs;
+        if (m_intervalNs == 0)
+            m_deadlineNs = now;
+    }
+    armTimer();
+}
+
+void TimeredGrabber::armTimer() {
+#ifdef Q_OS_LINUX
+    if (m_timerFd != -1) {
+        struct itimerspec spec;
+        memset(&spec, 0, sizeof(spec));
+        // zero it_value disarms timerfd, deadline in the past fires immediately
+        const qint64 deadline = qMax(m_deadlineNs, qint64(1));
+        spec.it_value.tv_sec = deadline / NsPerSec;
+        spec.it_value.tv_nsec = deadline % NsPerSec;
+        if (timerfd_settime(m_timerFd, TFD_TIMER_ABSTIME, &spec, NULL) == -1)
+            qWarning() << Q_FUNC_INFO << "timerfd_settime failed:" << strerror(errno);
+        return;
+    }
+#endif
+    const qint64 remainingNs = m_deadlineNs - monotonicNs();
+    m_timer->start(remainingNs > 0 ? static_cast<int>((remainingNs + NsPerMs / 2) / NsPerMs) : 0);
+}
+
+void TimeredGrabber::disarmTimer() {
+#ifdef Q_OS_LINUX
+    if (m_timerFd != -1) {
+        struct itimerspec spec;
+        memset(&spec, 0, sizeof(spec));
+        timerfd_settime(m_timerFd, 0, &spec, NULL);
+        return;
+    }
+#endif
+    m_timer->stop();
+}
+
+qint64 TimeredGrabber::monotonicNs() {
+#ifdef Q_OS_LINUX
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * NsPerSec + ts.tv_nsec;
+#else
+    static QElapsedTimer clock;
+    if (!clock.isValid())
+        clock.start();
+    return clock.nsecsElapsed();
+#endif
 }
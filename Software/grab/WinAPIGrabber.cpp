@@ -71,7 +71,10 @@ void WinAPIGrabber::freeScreens()
         delete d;
 
         if (_screensWithWidgets[i].imgData != NULL) {
-            free(_screensWithWidgets[i].imgData);
+            FrameBuffer buffer;
+            buffer.ptr = _screensWithWidgets[i].imgData;
+            buffer.size = _screensWithWidgets[i].imgDataSize;
+            _context->bufferArena.release(buffer);
             _screensWithWidgets[i].imgData = NULL;
             _screensWithWidgets[i].imgDataSize = 0;
         }
@@ -80,11 +83,13 @@ void WinAPIGrabber::freeScreens()
     _screensWithWidgets.clear();
 }
 
-QList< ScreenInfo > * WinAPIGrabber::screensWithWidgets(QList< ScreenInfo > * result, const QList<GrabWidget *> &grabWidgets)
+QList< ScreenInfo > * WinAPIGrabber::screensWithWidgets(QList< ScreenInfo > * result, const QList<GrabZone> &grabZones)
 {
     result->clear();
-    for (int i = 0; i < grabWidgets.size(); ++i) {
-        HMONITOR hMonitorNew = MonitorFromWindow(reinterpret_cast<HWND>(grabWidgets[i]->winId()), MONITOR_DEFAULTTONULL);
+    for (int i = 0; i < grabZones.size(); ++i) {
+        const QRect &zoneRect = grabZones[i].rect;
+        RECT rect = { zoneRect.left(), zoneRect.top(), zoneRect.right() + 1, zoneRect.bottom() + 1 };
+        HMONITOR hMonitorNew = MonitorFromRect(&rect, MONITOR_DEFAULTTONULL);
 
         if (hMonitorNew != NULL) {
             MONITORINFO monitorInfo;
@@ -154,9 +159,20 @@ bool WinAPIGrabber::reallocate(const QList< ScreenInfo > &screens)
             qCritical() << "Not 32-bit mode is not supported!" << bytesPerPixel;
         }
 
+        FrameBuffer buffer = _context->bufferArena.acquire(pixelsBuffSizeNew);
+        if (buffer.isNull()) {
+            qCritical() << Q_FUNC_INFO << "couldn't allocate image buffer";
+            DeleteObject(d->hScreenDC);
+            DeleteObject(d->hBitmap);
+            DeleteObject(d->hMemDC);
+            delete d;
+            freeScreens();
+            return false;
+        }
+
         GrabbedScreen grabScreen;
         grabScreen.imgDataSize = pixelsBuffSizeNew;
-        grabScreen.imgData = (BYTE *)malloc(grabScreen.imgDataSize);
+        grabScreen.imgData = buffer.ptr;
         grabScreen.imgFormat = BufferFormatArgb;
         grabScreen.screenInfo = screen;
         grabScreen.associatedData = d;
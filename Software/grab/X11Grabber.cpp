@@ -31,6 +31,9 @@
 // x shared-mem extension
 #include <sys/shm.h>
 #include <X11/extensions/XShm.h>
+#include <X11/extensions/Xdamage.h>
+#include <X11/extensions/Xfixes.h>
+#include <X11/extensions/Xrandr.h>
 #include <cmath>
 #include <sys/ipc.h>
 #include <errno.h>
@@ -46,39 +49,281 @@ struct X11GrabberData
 
     XImage *image;
     XShmSegmentInfo shminfo;
+    QPoint offset; // position of the grabbed region inside the root window
 };
 
+namespace {
+    // every region costs a shm segment and a XShmGetImage round trip
+    const int MaxRegionsPerMonitor = 16;
+
+    qint64 area(const QRect &rect) {
+        return rect.isValid() ? qint64(rect.width()) * rect.height() : 0;
+    }
+
+    /*!
+      Merges widget rects into a few bounding regions (usually one strip per screen edge).
+      Regions never overlap, so every widget rect lies entirely inside one of them.
+    */
+    void mergeRegions(QList<QRect> *regions) {
+        forever {
+            int bestA = -1, bestB = -1;
+            qint64 bestWaste = 0, bestCovered = 0;
+            for (int a = 0; a < regions->size() && bestWaste >= 0; ++a) {
+                for (int b = a + 1; b < regions->size(); ++b) {
+                    const QRect &rectA = regions->at(a);
+                    const QRect &rectB = regions->at(b);
+                    if (rectA.intersects(rectB)) {
+                        // overlapping regions are always merged
+                        bestA = a;
+                        bestB = b;
+                        bestWaste = -1;
+                        break;
+                    }
+                    const qint64 covered = area(rectA) + area(rectB);
+                    const qint64 waste = area(rectA.united(rectB)) - covered;
+                    if (bestA < 0 || waste < bestWaste) {
+                        bestA = a;
+                        bestB = b;
+                        bestWaste = waste;
+                        bestCovered = covered;
+                    }
+                }
+            }
+            if (bestA < 0)
+                return;
+            // allow up to 25% of pixels which are not covered by any widget
+            if (bestWaste * 4 > bestCovered && regions->size() <= MaxRegionsPerMonitor)
+                return;
+            (*regions)[bestA] = regions->at(bestA).united(regions->at(bestB));
+            regions->removeAt(bestB);
+        }
+    }
+}
+
 X11Grabber::X11Grabber(QObject *parent, GrabberContext * context)
     : TimeredGrabber(parent, context)
+    , _isDamageSupported(false)
+    , _isRandrSupported(false)
+    , _randrEventBase(0)
+    , _isMonitorsUpdateNeeded(true)
+    , _isFullGrabNeeded(true)
+    , _damageRegion(None)
+    , _isMonitorsChanged(true)
 {
     _display = XOpenDisplay(NULL);
+    if (_display == NULL) {
+        qWarning() << Q_FUNC_INFO << "couldn't open X display, nothing will be grabbed";
+        return;
+    }
+    initDamage();
+    initRandr();
 }
 
 X11Grabber::~X11Grabber()
 {
     freeScreens();
+    if (_display == NULL)
+        return;
+    for (int i = 0; i < _damages.size(); ++i)
+        XDamageDestroy(_display, _damages[i]);
+    if (_damageRegion != None)
+        XFixesDestroyRegion(_display, _damageRegion);
     XCloseDisplay(_display);
 }
 
-QList<ScreenInfo> * X11Grabber::screensWithWidgets(QList<ScreenInfo> *result, const QList<GrabWidget *> &grabWidgets)
+void X11Grabber::initDamage()
 {
-    result->clear();
+    int damageEventBase, damageErrorBase, fixesEventBase, fixesErrorBase;
+    if (!XDamageQueryExtension(_display, &damageEventBase, &damageErrorBase)
+        || !XFixesQueryExtension(_display, &fixesEventBase, &fixesErrorBase)) {
+        qWarning() << Q_FUNC_INFO << "XDamage is not available, every frame will be grabbed";
+        return;
+    }
+
+    int major = 1, minor = 1;
+    XDamageQueryVersion(_display, &major, &minor);
+    major = 2; minor = 0;
+    XFixesQueryVersion(_display, &major, &minor);
+
+    // NonEmpty: at most one DamageNotify per root between two grabs
+    for (int i = 0; i < ScreenCount(_display); ++i)
+        _damages.append(XDamageCreate(_display, RootWindow(_display, i), XDamageReportNonEmpty));
+    _damageRegion = XFixesCreateRegion(_display, NULL, 0);
+    _isDamageSupported = true;
+}
+
+void X11Grabber::initRandr()
+{
+    int randrErrorBase, major = 0, minor = 0;
+    if (!XRRQueryExtension(_display, &_randrEventBase, &randrErrorBase)
+        || !XRRQueryVersion(_display, &major, &minor)
+        || (major == 1 && minor < 3)) {
+        qWarning() << Q_FUNC_INFO << "XRandR 1.3 is not available, every X screen is grabbed as a single monitor";
+        return;
+    }
+
+    for (int i = 0; i < ScreenCount(_display); ++i)
+        XRRSelectInput(_display, RootWindow(_display, i), RRScreenChangeNotifyMask | RRCrtcChangeNotifyMask);
+    _isRandrSupported = true;
+}
+
+void X11Grabber::processEvents()
+{
+    while (XPending(_display)) {
+        XEvent event;
+        XNextEvent(_display, &event);
+        // DamageNotify is ignored, fetchDamage() takes the damage itself
+        if (_isRandrSupported
+            && (event.type == _randrEventBase + RRScreenChangeNotify || event.type == _randrEventBase + RRNotify)) {
+            XRRUpdateConfiguration(&event);
+            _isMonitorsUpdateNeeded = true;
+        }
+    }
+
+    // without RandR there is nothing to be notified by, root geometry is checked every time
+    if (_isMonitorsUpdateNeeded || !_isRandrSupported) {
+        updateMonitors();
+        _isMonitorsUpdateNeeded = false;
+    }
+}
+
+void X11Grabber::updateMonitors()
+{
+    QList<QRect> monitorRects;
+    QList<int> monitorScreens;
 
     for (int i = 0; i < ScreenCount(_display); ++i) {
-        XWindowAttributes xwa;
-        XGetWindowAttributes(_display, RootWindow(_display, i), &xwa);
-        ScreenInfo screen;
-        intptr_t handle = i;
-        screen.handle = reinterpret_cast<void *>(handle);
-        screen.rect = QRect(xwa.x, xwa.y, xwa.width, xwa.height);
-        for (int k = 0; k < grabWidgets.size(); ++k) {
-            if (screen.rect.intersects(grabWidgets[k]->rect())) {
-                result->append(screen);
-                break;
+        const Window root = RootWindow(_display, i);
+        bool isCrtcFound = false;
+
+        if (_isRandrSupported) {
+            XRRScreenResources *resources = XRRGetScreenResourcesCurrent(_display, root);
+            for (int c = 0; resources != NULL && c < resources->ncrtc; ++c) {
+                XRRCrtcInfo *crtc = XRRGetCrtcInfo(_display, resources, resources->crtcs[c]);
+                if (crtc != NULL && crtc->mode != None && crtc->noutput > 0) {
+                    const QRect crtcRect(crtc->x, crtc->y, crtc->width, crtc->height);
+                    isCrtcFound = true;
+                    // cloned outputs are driven by different CRTCs with the same geometry
+                    bool isDuplicate = false;
+                    for (int k = 0; k < monitorRects.size(); ++k)
+                        isDuplicate = isDuplicate || (monitorScreens[k] == i && monitorRects[k] == crtcRect);
+                    if (!isDuplicate) {
+                        monitorRects.append(crtcRect);
+                        monitorScreens.append(i);
+                    }
+                }
+                if (crtc != NULL)
+                    XRRFreeCrtcInfo(crtc);
             }
+            if (resources != NULL)
+                XRRFreeScreenResources(resources);
+        }
+
+        if (!isCrtcFound) {
+            XWindowAttributes xwa;
+            XGetWindowAttributes(_display, root, &xwa);
+            monitorRects.append(QRect(xwa.x, xwa.y, xwa.width, xwa.height));
+            monitorScreens.append(i);
+        }
+    }
+
+    if (monitorRects != _monitorRects || monitorScreens != _monitorScreens) {
+        DEBUG_LOW_LEVEL << Q_FUNC_INFO << "monitors:" << monitorRects.size();
+        _monitorRects = monitorRects;
+        _monitorScreens = monitorScreens;
+        _isMonitorsChanged = true;
+    }
+}
+
+/*!
+  Takes damage accumulated since the previous call, rects are in root window coordinates
+*/
+void X11Grabber::fetchDamage(QList< QList<QRect> > *damagedRects)
+{
+    damagedRects->clear();
+    for (int i = 0; i < _damages.size(); ++i) {
+        XDamageSubtract(_display, _damages[i], None, _damageRegion);
+
+        int count = 0;
+        XRectangle *rects = XFixesFetchRegion(_display, _damageRegion, &count);
+        QList<QRect> screenRects;
+        for (int k = 0; k < count; ++k)
+            screenRects.append(QRect(rects[k].x, rects[k].y, rects[k].width, rects[k].height));
+        if (rects)
+            XFree(rects);
+        damagedRects->append(screenRects);
+    }
+}
+
+bool X11Grabber::isZoneDamaged(const QRect &rect) const
+{
+    for (int i = 0; i < _lastWidgetRects.size(); ++i) {
+        if (_lastWidgetRects[i].intersects(rect))
+            return true;
+    }
+    return false;
+}
+
+/*!
+  Instead of whole root windows only regions of every monitor covered by grab widgets are
+  grabbed, each region is reported as a separate ScreenInfo so GrabberBase averages inside
+  it directly.
+*/
+QList<ScreenInfo> * X11Grabber::screensWithWidgets(QList<ScreenInfo> *result, const QList<GrabZone> &grabZones)
+{
+    if (_display == NULL) {
+        result->clear();
+        return result;
+    }
+
+    processEvents();
+
+    QList<QRect> widgetRects;
+    QList<bool> areaEnabled;
+    widgetRects.reserve(grabZones.size());
+    areaEnabled.reserve(grabZones.size());
+    for (int k = 0; k < grabZones.size(); ++k) {
+        widgetRects.append(grabZones[k].rect);
+        areaEnabled.append(grabZones[k].isAreaEnabled);
+    }
+
+    // colors of newly enabled zones are not calculated yet
+    if (areaEnabled != _lastAreaEnabled) {
+        _lastAreaEnabled = areaEnabled;
+        _isFullGrabNeeded = true;
+    }
+
+    // merging is quadratic, redo it only when widgets or monitors are changed
+    if (widgetRects == _lastWidgetRects && !_isMonitorsChanged) {
+        *result = _lastRegions;
+        return result;
+    }
+
+    result->clear();
+
+    for (int i = 0; i < _monitorRects.size(); ++i) {
+        const QRect &monitorRect = _monitorRects[i];
+
+        QList<QRect> regions;
+        for (int k = 0; k < widgetRects.size(); ++k) {
+            QRect clipped = monitorRect.intersected(widgetRects[k]);
+            if (clipped.isValid())
+                regions.append(clipped);
+        }
+        mergeRegions(&regions);
+
+        for (int k = 0; k < regions.size(); ++k) {
+            ScreenInfo region;
+            intptr_t handle = _monitorScreens[i];
+            region.handle = reinterpret_cast<void *>(handle);
+            region.rect = regions[k];
+            result->append(region);
         }
     }
 
+    _lastWidgetRects = widgetRects;
+    _isMonitorsChanged = false;
+    _lastRegions = *result;
     return result;
 }
 
@@ -100,6 +345,7 @@ void X11Grabber::freeScreens()
 bool X11Grabber::reallocate(const QList<ScreenInfo> &screens)
 {
     freeScreens();
+    _isFullGrabNeeded = true;
 
     for (int i = 0; i < screens.size(); ++i) {
 
@@ -114,6 +360,10 @@ bool X11Grabber::reallocate(const QList<ScreenInfo> &screens)
 
         Screen * xscreen = ScreenOfDisplay(_display, screenid);
 
+        XWindowAttributes xwa;
+        XGetWindowAttributes(_display, RootWindowOfScreen(xscreen), &xwa);
+        d->offset = screens[i].rect.topLeft() - QPoint(xwa.x, xwa.y);
+
         d->image = XShmCreateImage(_display, DefaultVisualOfScreen(xscreen),
                                    DefaultDepthOfScreen(xscreen),
                                    ZPixmap, NULL, &d->shminfo,
@@ -149,15 +399,54 @@ bool X11Grabber::reallocate(const QList<ScreenInfo> &screens)
 
 GrabResult X11Grabber::grabScreens()
 {
+    QList< QList<QRect> > damagedRects;
+    if (_isDamageSupported)
+        fetchDamage(&damagedRects);
+
+    bool isAnythingGrabbed = false;
     for (int i = 0; i < _screensWithWidgets.size(); ++i) {
+        X11GrabberData *d = reinterpret_cast<X11GrabberData *>(_screensWithWidgets[i].associatedData);
+        const int screenid = reinterpret_cast<intptr_t>(_screensWithWidgets[i].screenInfo.handle);
+        const Window root = RootWindow(_display, screenid);
+
+        if (_isDamageSupported && !_isFullGrabNeeded) {
+            const QRect regionRect(d->offset, _screensWithWidgets[i].screenInfo.rect.size());
+            const QPoint screenOrigin = _screensWithWidgets[i].screenInfo.rect.topLeft() - d->offset;
+            QRect dirtyRect;
+            const QList<QRect> &screenDamage = damagedRects[screenid];
+            for (int k = 0; k < screenDamage.size(); ++k) {
+                const QRect damage = screenDamage[k].intersected(regionRect);
+                if (damage.isValid() && isZoneDamaged(damage.translated(screenOrigin)))
+                    dirtyRect = dirtyRect.united(damage);
+            }
+
+            if (!dirtyRect.isValid())
+                continue;
+
+            // small updates are copied without shm, straight into the region image
+            if (qint64(dirtyRect.width()) * dirtyRect.height() * 4 < qint64(regionRect.width()) * regionRect.height()) {
+                XGetSubImage(_display, root,
+                             dirtyRect.x(), dirtyRect.y(), dirtyRect.width(), dirtyRect.height(),
+                             0x00FFFFFF, ZPixmap, d->image,
+                             dirtyRect.x() - d->offset.x(), dirtyRect.y() - d->offset.y());
+                isAnythingGrabbed = true;
+                continue;
+            }
+        }
+
         XShmGetImage(_display,
-                     RootWindow(_display, reinterpret_cast<intptr_t>(_screensWithWidgets[i].screenInfo.handle)),
-                     reinterpret_cast<X11GrabberData *>(_screensWithWidgets[i].associatedData)->image,
-                     0,
-                     0,
+                     root,
+                     d->image,
+                     d->offset.x(),
+                     d->offset.y(),
                      0x00FFFFFF
                      );
+        isAnythingGrabbed = true;
     }
+    _isFullGrabNeeded = false;
+
+    if (!isAnythingGrabbed && !_screensWithWidgets.isEmpty())
+        return GrabResultFrameUnchanged;
 #if 0
     DEBUG_LOW_LEVEL << "QImage";
     QImage *pic = new QImage(1024,768,QImage::Format_RGB32);
@@ -178,13 +467,6 @@ GrabResult X11Grabber::grabScreens()
     DEBUG_LOW_LEVEL << "save";
     pic->save("/home/atarity/.Lightpack/test.bmp");
 #endif
-    /*
-    _context->grabResult->clear();
-    foreach(GrabWidget * widget, *_context->grabWidgets) {
-        _context->grabResult->append( widget->isAreaEnabled() ? getColor(widget) : qRgb(0,0,0) );
-    }
-    return GrabResultOk;
-    */
     return GrabResultOk;
 }
 
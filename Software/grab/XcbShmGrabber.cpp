@@ -0,0 +1,256 @@
+/*
+ * XcbShmGrabber.cpp
+ *
+ *  Created on: 18.10.2026
+ *     Project: Lightpack
+ *
+ *  Copyright (c) 2026 Lightpack contributors
+ *
+ *  Lightpack a USB content-driving ambient lighting system
+ *
+ *  Lightpack is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Lightpack is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "XcbShmGrabber.hpp"
+
+#ifdef XCB_SHM_GRAB_SUPPORT
+
+#include <xcb/xcb.h>
+#include <xcb/shm.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+namespace {
+    const int BuffersCount = 2;
+}
+
+struct XcbShmGrabberData
+{
+    XcbShmGrabberData()
+        : root(0)
+        , front(0)
+    {
+        for (int i = 0; i < BuffersCount; ++i) {
+            shmid[i] = -1;
+            shmseg[i] = 0;
+            mem[i] = NULL;
+        }
+        cookie.sequence = 0;
+    }
+
+    xcb_window_t root;
+    int shmid[BuffersCount];
+    xcb_shm_seg_t shmseg[BuffersCount];
+    unsigned char *mem[BuffersCount];
+    int front; // buffer colors are calculated from, X server writes to the other one
+    xcb_shm_get_image_cookie_t cookie;
+};
+
+XcbShmGrabber::XcbShmGrabber(QObject *parent, GrabberContext *context)
+    : TimeredGrabber(parent, context)
+    , _isShmSupported(false)
+    , _isFrameRequested(false)
+{
+    _connection = xcb_connect(NULL, NULL);
+    if (xcb_connection_has_error(_connection)) {
+        qCritical() << Q_FUNC_INFO << "couldn't connect to X server";
+        return;
+    }
+
+    xcb_shm_query_version_reply_t *version = xcb_shm_query_version_reply(_connection, xcb_shm_query_version(_connection), NULL);
+    _isShmSupported = version != NULL;
+    free(version);
+
+    if (!_isShmSupported)
+        qCritical() << Q_FUNC_INFO << "MIT-SHM extension is not available";
+}
+
+XcbShmGrabber::~XcbShmGrabber()
+{
+    freeScreens();
+    xcb_disconnect(_connection);
+}
+
+QList<ScreenInfo> * XcbShmGrabber::screensWithWidgets(QList<ScreenInfo> *result, const QList<GrabZone> &grabZones)
+{
+    result->clear();
+    if (!_isShmSupported)
+        return result;
+
+    xcb_screen_iterator_t iter = xcb_setup_roots_iterator(xcb_get_setup(_connection));
+    for (int i = 0; iter.rem; ++i, xcb_screen_next(&iter)) {
+        ScreenInfo screen;
+        intptr_t handle = i;
+        screen.handle = reinterpret_cast<void *>(handle);
+        screen.rect = QRect(0, 0, iter.data->width_in_pixels, iter.data->height_in_pixels);
+        for (int k = 0; k < grabZones.size(); ++k) {
+            if (screen.rect.intersects(grabZones[k].rect)) {
+                result->append(screen);
+                break;
+            }
+        }
+    }
+
+    return result;
+}
+
+void XcbShmGrabber::stopGrabbing()
+{
+    TimeredGrabber::stopGrabbing();
+    // the frame requested before stop is stale by the time grabbing is started again
+    discardRequestedFrame();
+}
+
+void XcbShmGrabber::discardRequestedFrame()
+{
+    // replies of requests in flight still have to be taken from the connection
+    if (_isFrameRequested) {
+        for (int i = 0; i < _screensWithWidgets.size(); ++i) {
+            XcbShmGrabberData *d = reinterpret_cast<XcbShmGrabberData *>(_screensWithWidgets[i].associatedData);
+            free(xcb_shm_get_image_reply(_connection, d->cookie, NULL));
+        }
+    }
+    _isFrameRequested = false;
+}
+
+void XcbShmGrabber::freeScreens()
+{
+    discardRequestedFrame();
+
+    for (int i = 0; i < _screensWithWidgets.size(); ++i) {
+        XcbShmGrabberData *d = reinterpret_cast<XcbShmGrabberData *>(_screensWithWidgets[i].associatedData);
+        for (int b = 0; b < BuffersCount; ++b) {
+            if (d->shmseg[b] != 0)
+                xcb_shm_detach(_connection, d->shmseg[b]);
+            if (d->mem[b] != NULL)
+                shmdt(d->mem[b]);
+            if (d->shmid[b] != -1)
+                shmctl(d->shmid[b], IPC_RMID, 0);
+        }
+        delete d;
+    }
+    xcb_flush(_connection);
+
+    _screensWithWidgets.clear();
+}
+
+bool XcbShmGrabber::reallocate(const QList<ScreenInfo> &screens)
+{
+    freeScreens();
+
+    for (int i = 0; i < screens.size(); ++i) {
+        const size_t imageSize = screens[i].rect.width() * screens[i].rect.height() * 4;
+        const int screenid = reinterpret_cast<intptr_t>(screens[i].handle);
+
+        DEBUG_HIGH_LEVEL << "dimensions " << screens[i].rect.width() << "x" << screens[i].rect.height() << screenid;
+
+        XcbShmGrabberData *d = new XcbShmGrabberData();
+        xcb_screen_iterator_t iter = xcb_setup_roots_iterator(xcb_get_setup(_connection));
+        for (int k = 0; k < screenid && iter.rem; ++k)
+            xcb_screen_next(&iter);
+        d->root = iter.data->root;
+
+        GrabbedScreen grabScreen;
+        grabScreen.imgDataSize = imageSize;
+        grabScreen.imgFormat = BufferFormatArgb;
+        grabScreen.screenInfo = screens[i];
+        grabScreen.associatedData = d;
+        _screensWithWidgets.append(grabScreen);
+
+        for (int b = 0; b < BuffersCount; ++b) {
+            d->shmid[b] = shmget(IPC_PRIVATE, imageSize, IPC_CREAT | 0600);
+            if (d->shmid[b] == -1) {
+                qCritical() << Q_FUNC_INFO << " error occured while trying to get shared memory: " << strerror(errno);
+                freeScreens();
+                return false;
+            }
+
+            void *mem = shmat(d->shmid[b], 0, 0);
+            if (mem == reinterpret_cast<void *>(-1)) {
+                qCritical() << Q_FUNC_INFO << " error occured while trying to attach shared memory: " << strerror(errno);
+                freeScreens();
+                return false;
+            }
+            d->mem[b] = reinterpret_cast<unsigned char *>(mem);
+
+            const xcb_shm_seg_t shmseg = xcb_generate_id(_connection);
+            xcb_generic_error_t *error = xcb_request_check(_connection, xcb_shm_attach_checked(_connection, shmseg, d->shmid[b], 0));
+            if (error != NULL) {
+                qCritical() << Q_FUNC_INFO << "X server couldn't attach shared memory, error code:" << error->error_code;
+                free(error);
+                freeScreens();
+                return false;
+            }
+            d->shmseg[b] = shmseg;
+        }
+        _screensWithWidgets.last().imgData = d->mem[d->front];
+    }
+    xcb_flush(_connection);
+
+    return true;
+}
+
+void XcbShmGrabber::requestFrame()
+{
+    for (int i = 0; i < _screensWithWidgets.size(); ++i) {
+        XcbShmGrabberData *d = reinterpret_cast<XcbShmGrabberData *>(_screensWithWidgets[i].associatedData);
+        const QRect &rect = _screensWithWidgets[i].screenInfo.rect;
+        const int back = (d->front + 1) % BuffersCount;
+        d->cookie = xcb_shm_get_image(_connection, d->root,
+                                      0, 0, rect.width(), rect.height(),
+                                      ~0, XCB_IMAGE_FORMAT_Z_PIXMAP,
+                                      d->shmseg[back], 0);
+    }
+    xcb_flush(_connection);
+    _isFrameRequested = true;
+}
+
+GrabResult XcbShmGrabber::grabScreens()
+{
+    if (!_isShmSupported)
+        return GrabResultError;
+
+    if (!_isFrameRequested) {
+        requestFrame();
+        return GrabResultFrameNotReady;
+    }
+
+    GrabResult result = GrabResultOk;
+    for (int i = 0; i < _screensWithWidgets.size(); ++i) {
+        XcbShmGrabberData *d = reinterpret_cast<XcbShmGrabberData *>(_screensWithWidgets[i].associatedData);
+        xcb_generic_error_t *error = NULL;
+        xcb_shm_get_image_reply_t *reply = xcb_shm_get_image_reply(_connection, d->cookie, &error);
+        if (reply == NULL) {
+            qWarning() << Q_FUNC_INFO << "xcb_shm_get_image failed, error code:" << (error ? error->error_code : 0);
+            result = GrabResultError;
+        } else {
+            d->front = (d->front + 1) % BuffersCount;
+            _screensWithWidgets[i].imgData = d->mem[d->front];
+        }
+        free(reply);
+        free(error);
+    }
+
+    // X server fills the other buffers while colors of this frame are calculated
+    requestFrame();
+
+    return result;
+}
+
+#endif // XCB_SHM_GRAB_SUPPORT
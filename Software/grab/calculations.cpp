@@ -24,6 +24,26 @@
  */
 
 #include "calculations.hpp"
+#include <QVarLengthArray>
+#include <algorithm>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#   define GRAB_X86_SIMD
+#endif
+
+#ifdef GRAB_X86_SIMD
+#   if defined(_MSC_VER)
+#       include <intrin.h>
+#       define GRAB_TARGET(isa)
+#   else
+#       include <cpuid.h>
+#       define GRAB_TARGET(isa) __attribute__((target(isa)))
+#   endif
+#   include <emmintrin.h>
+#   include <tmmintrin.h>
+#   include <immintrin.h>
+#endif
 
 namespace {
     const char bytesPerPixel = 4;
@@ -32,6 +52,16 @@ namespace {
         int r, g, b;
     };
 
+    /*!
+      Sums of every byte lane of 32-bit pixels: lane[0] accumulates the bytes at offset 0,
+      lane[1] at offset 1 and so on. Lanes wrap around the same way as scalar unsigned sums do.
+    */
+    struct LaneSums {
+        unsigned int lane[4];
+    };
+
+    typedef int (*AccumulateLanesFunc)(const unsigned char *buffer, unsigned int pitch, const QRect &rect, LaneSums *sums);
+
     static int accumulateBufferFormatArgb(
             const unsigned char *buffer,
             unsigned int pitch,
@@ -127,37 +157,651 @@ namespace {
         resultColor->b = b;
         return count;
     }
+
+#ifdef GRAB_X86_SIMD
+    void cpuid(int leaf, int subleaf, unsigned int regs[4]) {
+#   if defined(_MSC_VER)
+        int info[4];
+        __cpuidex(info, leaf, subleaf);
+        for (int i = 0; i < 4; ++i)
+            regs[i] = info[i];
+#   else
+        __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#   endif
+    }
+
+    bool isAvxStateEnabledByOs() {
+#   if defined(_MSC_VER)
+        return (_xgetbv(0) & 0x6) == 0x6;
+#   else
+        unsigned int eax, edx;
+        __asm__ ("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+        return (eax & 0x6) == 0x6;
+#   endif
+    }
+
+    void storeLaneSums(unsigned long long lane0, unsigned long long lane1,
+                       unsigned long long lane2, unsigned long long lane3,
+                       LaneSums *sums) {
+        sums->lane[0] = static_cast<unsigned int>(lane0);
+        sums->lane[1] = static_cast<unsigned int>(lane1);
+        sums->lane[2] = static_cast<unsigned int>(lane2);
+        sums->lane[3] = static_cast<unsigned int>(lane3);
+    }
+
+    GRAB_TARGET("sse2")
+    unsigned long long lowQword(__m128i v) {
+        unsigned long long result;
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(&result), v);
+        return result;
+    }
+
+    GRAB_TARGET("sse2")
+    unsigned long long highQword(__m128i v) {
+        return lowQword(_mm_unpackhi_epi64(v, v));
+    }
+
+    /*!
+      SSE2: isolate every byte lane with shift+mask and sum it horizontally with psadbw,
+      each 64-bit half of the accumulators holds the sum of two pixels.
+    */
+    GRAB_TARGET("sse2")
+    int accumulateLanesSse2(
+            const unsigned char *buffer,
+            unsigned int pitch,
+            const QRect &rect,
+            LaneSums *sums) {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i lowByteMask = _mm_set1_epi32(0xff);
+        __m128i acc0 = zero, acc1 = zero, acc2 = zero, acc3 = zero;
+        int count = 0;
+        for(int currentY = 0; currentY < rect.height(); currentY++) {
+            const unsigned char *row = buffer + pitch * (rect.y()+currentY) + rect.x()*bytesPerPixel;
+            for(int currentX = 0; currentX < rect.width(); currentX += 4) {
+                const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row));
+                acc0 = _mm_add_epi64(acc0, _mm_sad_epu8(_mm_and_si128(pixels, lowByteMask), zero));
+                acc1 = _mm_add_epi64(acc1, _mm_sad_epu8(_mm_and_si128(_mm_srli_epi32(pixels, 8), lowByteMask), zero));
+                acc2 = _mm_add_epi64(acc2, _mm_sad_epu8(_mm_and_si128(_mm_srli_epi32(pixels, 16), lowByteMask), zero));
+                acc3 = _mm_add_epi64(acc3, _mm_sad_epu8(_mm_srli_epi32(pixels, 24), zero));
+                count += 4;
+                row += bytesPerPixel * 4;
+            }
+        }
+
+        storeLaneSums(lowQword(acc0) + highQword(acc0),
+                      lowQword(acc1) + highQword(acc1),
+                      lowQword(acc2) + highQword(acc2),
+                      lowQword(acc3) + highQword(acc3),
+                      sums);
+        return count;
+    }
+
+    /*!
+      SSSE3: pshufb gathers lanes 0/1 and lanes 2/3 of four pixels into separate
+      64-bit halves, so two psadbw give all four lane sums.
+    */
+    GRAB_TARGET("ssse3")
+    int accumulateLanesSsse3(
+            const unsigned char *buffer,
+            unsigned int pitch,
+            const QRect &rect,
+            LaneSums *sums) {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i shuffleLanes01 = _mm_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, 1, 5, 9, 13, -1, -1, -1, -1);
+        const __m128i shuffleLanes23 = _mm_setr_epi8(2, 6, 10, 14, -1, -1, -1, -1, 3, 7, 11, 15, -1, -1, -1, -1);
+        __m128i acc01 = zero, acc23 = zero;
+        int count = 0;
+        for(int currentY = 0; currentY < rect.height(); currentY++) {
+            const unsigned char *row = buffer + pitch * (rect.y()+currentY) + rect.x()*bytesPerPixel;
+            for(int currentX = 0; currentX < rect.width(); currentX += 4) {
+                const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row));
+                acc01 = _mm_add_epi64(acc01, _mm_sad_epu8(_mm_shuffle_epi8(pixels, shuffleLanes01), zero));
+                acc23 = _mm_add_epi64(acc23, _mm_sad_epu8(_mm_shuffle_epi8(pixels, shuffleLanes23), zero));
+                count += 4;
+                row += bytesPerPixel * 4;
+            }
+        }
+
+        storeLaneSums(lowQword(acc01), highQword(acc01), lowQword(acc23), highQword(acc23), sums);
+        return count;
+    }
+
+    /*!
+      AVX2: same as SSSE3 but eight pixels per iteration (vpshufb works per 128-bit lane),
+      a remaining group of four pixels is handled with 128-bit instructions.
+    */
+    GRAB_TARGET("avx2")
+    int accumulateLanesAvx2(
+            const unsigned char *buffer,
+            unsigned int pitch,
+            const QRect &rect,
+            LaneSums *sums) {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i shuffleLanes01 = _mm256_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, 1, 5, 9, 13, -1, -1, -1, -1,
+                                                        0, 4, 8, 12, -1, -1, -1, -1, 1, 5, 9, 13, -1, -1, -1, -1);
+        const __m256i shuffleLanes23 = _mm256_setr_epi8(2, 6, 10, 14, -1, -1, -1, -1, 3, 7, 11, 15, -1, -1, -1, -1,
+                                                        2, 6, 10, 14, -1, -1, -1, -1, 3, 7, 11, 15, -1, -1, -1, -1);
+        __m256i acc01 = zero, acc23 = zero;
+        __m128i tail01 = _mm_setzero_si128(), tail23 = _mm_setzero_si128();
+        int count = 0;
+        for(int currentY = 0; currentY < rect.height(); currentY++) {
+            const unsigned char *row = buffer + pitch * (rect.y()+currentY) + rect.x()*bytesPerPixel;
+            int currentX = 0;
+            for(; currentX + 8 <= rect.width(); currentX += 8) {
+                const __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(row));
+                acc01 = _mm256_add_epi64(acc01, _mm256_sad_epu8(_mm256_shuffle_epi8(pixels, shuffleLanes01), zero));
+                acc23 = _mm256_add_epi64(acc23, _mm256_sad_epu8(_mm256_shuffle_epi8(pixels, shuffleLanes23), zero));
+                count += 8;
+                row += bytesPerPixel * 8;
+            }
+            if (currentX < rect.width()) {
+                const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row));
+                tail01 = _mm_add_epi64(tail01, _mm_sad_epu8(_mm_shuffle_epi8(pixels, _mm256_castsi256_si128(shuffleLanes01)), _mm_setzero_si128()));
+                tail23 = _mm_add_epi64(tail23, _mm_sad_epu8(_mm_shuffle_epi8(pixels, _mm256_castsi256_si128(shuffleLanes23)), _mm_setzero_si128()));
+                count += 4;
+            }
+        }
+
+        const __m128i sum01 = _mm_add_epi64(tail01, _mm_add_epi64(_mm256_castsi256_si128(acc01), _mm256_extracti128_si256(acc01, 1)));
+        const __m128i sum23 = _mm_add_epi64(tail23, _mm_add_epi64(_mm256_castsi256_si128(acc23), _mm256_extracti128_si256(acc23, 1)));
+        storeLaneSums(lowQword(sum01), highQword(sum01), lowQword(sum23), highQword(sum23), sums);
+        return count;
+    }
+
+    /*!
+      AVX2 kernel for subsampling step 2: shuffles pick only even pixels and only every
+      second row is visited.
+    */
+    GRAB_TARGET("avx2")
+    int accumulateLanesEvenAvx2(
+            const unsigned char *buffer,
+            unsigned int pitch,
+            const QRect &rect,
+            LaneSums *sums) {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i shuffleLanes01 = _mm256_setr_epi8(0, 8, -1, -1, -1, -1, -1, -1, 1, 9, -1, -1, -1, -1, -1, -1,
+                                                        0, 8, -1, -1, -1, -1, -1, -1, 1, 9, -1, -1, -1, -1, -1, -1);
+        const __m256i shuffleLanes23 = _mm256_setr_epi8(2, 10, -1, -1, -1, -1, -1, -1, 3, 11, -1, -1, -1, -1, -1, -1,
+                                                        2, 10, -1, -1, -1, -1, -1, -1, 3, 11, -1, -1, -1, -1, -1, -1);
+        __m256i acc01 = zero, acc23 = zero;
+        __m128i tail01 = _mm_setzero_si128(), tail23 = _mm_setzero_si128();
+        int count = 0;
+        for(int currentY = 0; currentY < rect.height(); currentY += 2) {
+            const unsigned char *row = buffer + pitch * (rect.y()+currentY) + rect.x()*bytesPerPixel;
+            int currentX = 0;
+            for(; currentX + 8 <= rect.width(); currentX += 8) {
+                const __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(row));
+                acc01 = _mm256_add_epi64(acc01, _mm256_sad_epu8(_mm256_shuffle_epi8(pixels, shuffleLanes01), zero));
+                acc23 = _mm256_add_epi64(acc23, _mm256_sad_epu8(_mm256_shuffle_epi8(pixels, shuffleLanes23), zero));
+                count += 4;
+                row += bytesPerPixel * 8;
+            }
+            if (currentX < rect.width()) {
+                const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row));
+                tail01 = _mm_add_epi64(tail01, _mm_sad_epu8(_mm_shuffle_epi8(pixels, _mm256_castsi256_si128(shuffleLanes01)), _mm_setzero_si128()));
+                tail23 = _mm_add_epi64(tail23, _mm_sad_epu8(_mm_shuffle_epi8(pixels, _mm256_castsi256_si128(shuffleLanes23)), _mm_setzero_si128()));
+                count += 2;
+            }
+        }
+
+        const __m128i sum01 = _mm_add_epi64(tail01, _mm_add_epi64(_mm256_castsi256_si128(acc01), _mm256_extracti128_si256(acc01, 1)));
+        const __m128i sum23 = _mm_add_epi64(tail23, _mm_add_epi64(_mm256_castsi256_si128(acc23), _mm256_extracti128_si256(acc23, 1)));
+        storeLaneSums(lowQword(sum01), highQword(sum01), lowQword(sum23), highQword(sum23), sums);
+        return count;
+    }
+#endif // GRAB_X86_SIMD
+
+    int accumulateLanesScalar(
+            const unsigned char *buffer,
+            unsigned int pitch,
+            const QRect &rect,
+            LaneSums *sums) {
+        register unsigned int lane0=0, lane1=0, lane2=0, lane3=0;
+        int count = 0;
+        for(int currentY = 0; currentY < rect.height(); currentY++) {
+            int index = pitch * (rect.y()+currentY) + rect.x()*bytesPerPixel;
+            for(int currentX = 0; currentX < rect.width(); currentX += 4) {
+                lane0 += buffer[index]   + buffer[index + 4] + buffer[index + 8 ] + buffer[index + 12];
+                lane1 += buffer[index+1] + buffer[index + 5] + buffer[index + 9 ] + buffer[index + 13];
+                lane2 += buffer[index+2] + buffer[index + 6] + buffer[index + 10] + buffer[index + 14];
+                lane3 += buffer[index+3] + buffer[index + 7] + buffer[index + 11] + buffer[index + 15];
+                count += 4;
+                index += bytesPerPixel * 4;
+            }
+        }
+
+        sums->lane[0] = lane0;
+        sums->lane[1] = lane1;
+        sums->lane[2] = lane2;
+        sums->lane[3] = lane3;
+        return count;
+    }
+
+    /*!
+      Costs in pixels accumulated with SIMD. Building the integral image is scalar and costs
+      about as much as accumulating its area 5-6 times, a span costs a kernel call and
+      adding its sums to a zone costs a few more additions.
+    */
+    const int IntegralImagePixelCost = 6;
+    const int SpanCost = 16;
+    const int SpanZoneCost = 4;
+
+    Grab::Calculations::ZoneAveraging s_zoneAveraging = Grab::Calculations::ZoneAveragingAuto;
+
+    bool spanIsLess(const Grab::Calculations::ScanlineSpan &a, const Grab::Calculations::ScanlineSpan &b) {
+        return a.x < b.x;
+    }
+
+    /*!
+      Column of [0, step) that x falls on when columns are taken every step pixels
+    */
+    int columnPhase(int x, int step) {
+        return (x % step + step) % step;
+    }
+
+    /*!
+      Splits \a rowZones, which take the same columns of a row, at their edges and appends
+      a span for every piece covered by any of them.
+    */
+    void appendRowSpans(
+            Grab::Calculations::ScanlinePlan *plan,
+            const QVector<QRect> &zones,
+            const QVector<int> &rowZones,
+            QVector<int> *edges) {
+        edges->clear();
+        for (int i = 0; i < rowZones.size(); ++i) {
+            const QRect &zone = zones[rowZones[i]];
+            edges->append(zone.left());
+            edges->append(zone.left() + zone.width());
+        }
+        std::sort(edges->begin(), edges->end());
+        edges->resize(std::unique(edges->begin(), edges->end()) - edges->begin());
+
+        const int phase = columnPhase(zones[rowZones[0]].left(), plan->step);
+        for (int k = 0; k + 1 < edges->size(); ++k) {
+            const int left = (*edges)[k];
+            const int right = (*edges)[k + 1];
+            Grab::Calculations::ScanlineSpan span;
+            span.x = left + columnPhase(phase - left, plan->step);
+            span.width = right - span.x;
+            if (span.width <= 0)
+                continue;
+
+            span.firstZone = plan->spanZones.size();
+            for (int i = 0; i < rowZones.size(); ++i) {
+                const QRect &zone = zones[rowZones[i]];
+                if (zone.left() <= left && zone.left() + zone.width() >= right)
+                    plan->spanZones.append(rowZones[i]);
+            }
+            span.zonesCount = plan->spanZones.size() - span.firstZone;
+            if (span.zonesCount == 0)
+                continue;
+
+            plan->spans.append(span);
+            plan->spansArea += span.width;
+        }
+    }
+
+    Grab::Calculations::AccumulationKernel detectBestKernel() {
+#ifdef GRAB_X86_SIMD
+        unsigned int regs[4];
+        cpuid(0, 0, regs);
+        const unsigned int maxLeaf = regs[0];
+
+        cpuid(1, 0, regs);
+        const bool hasSse2  = (regs[3] & (1u << 26)) != 0;
+        const bool hasSsse3 = (regs[2] & (1u << 9)) != 0;
+        const bool hasAvx   = (regs[2] & (1u << 28)) != 0 && (regs[2] & (1u << 27)) != 0 && isAvxStateEnabledByOs();
+
+        bool hasAvx2 = false;
+        if (hasAvx && maxLeaf >= 7) {
+            cpuid(7, 0, regs);
+            hasAvx2 = (regs[1] & (1u << 5)) != 0;
+        }
+
+        if (hasAvx2)
+            return Grab::Calculations::AccumulationKernelAvx2;
+        if (hasSsse3)
+            return Grab::Calculations::AccumulationKernelSsse3;
+        if (hasSse2)
+            return Grab::Calculations::AccumulationKernelSse2;
+#endif
+        return Grab::Calculations::AccumulationKernelScalar;
+    }
+
+    AccumulateLanesFunc kernelFunc(Grab::Calculations::AccumulationKernel kernel) {
+        switch (kernel) {
+#ifdef GRAB_X86_SIMD
+        case Grab::Calculations::AccumulationKernelSse2:
+            return accumulateLanesSse2;
+        case Grab::Calculations::AccumulationKernelSsse3:
+            return accumulateLanesSsse3;
+        case Grab::Calculations::AccumulationKernelAvx2:
+            return accumulateLanesAvx2;
+#endif
+        default:
+            return NULL;
+        }
+    }
+
+    // CPU features are probed once, at static initialization time
+    const Grab::Calculations::AccumulationKernel s_bestKernel = detectBestKernel();
+    Grab::Calculations::AccumulationKernel s_activeKernel = s_bestKernel;
+    AccumulateLanesFunc s_accumulateLanes = kernelFunc(s_bestKernel);
+
+    int accumulateLanesStrided(
+            const unsigned char *buffer,
+            unsigned int pitch,
+            const QRect &rect,
+            int step,
+            LaneSums *sums) {
+#ifdef GRAB_X86_SIMD
+        // widths are aligned by 4, so step 2 never splits a group of four pixels
+        if (step == 2 && s_activeKernel == Grab::Calculations::AccumulationKernelAvx2)
+            return accumulateLanesEvenAvx2(buffer, pitch, rect, sums);
+#endif
+        unsigned int lane0=0, lane1=0, lane2=0, lane3=0;
+        int count = 0;
+        const int pixelStep = bytesPerPixel * step;
+        for(int currentY = 0; currentY < rect.height(); currentY += step) {
+            const unsigned char *pixel = buffer + pitch * (rect.y()+currentY) + rect.x()*bytesPerPixel;
+            for(int currentX = 0; currentX < rect.width(); currentX += step) {
+                lane0 += pixel[0];
+                lane1 += pixel[1];
+                lane2 += pixel[2];
+                lane3 += pixel[3];
+                count++;
+                pixel += pixelStep;
+            }
+        }
+
+        sums->lane[0] = lane0;
+        sums->lane[1] = lane1;
+        sums->lane[2] = lane2;
+        sums->lane[3] = lane3;
+        return count;
+    }
+
+    /*!
+      Picks r, g, b out of byte lane sums exactly like the scalar accumulateBufferFormat* do
+    */
+    bool colorFromLaneSums(BufferFormat bufferFormat, const LaneSums &sums, ColorValue *resultColor) {
+        switch(bufferFormat) {
+        case BufferFormatArgb:
+            resultColor->b = sums.lane[0];
+            resultColor->g = sums.lane[1];
+            resultColor->r = sums.lane[2];
+            return true;
+
+        case BufferFormatAbgr:
+            resultColor->r = sums.lane[0];
+            resultColor->g = sums.lane[1];
+            resultColor->b = sums.lane[2];
+            return true;
+
+        case BufferFormatRgba:
+            resultColor->b = sums.lane[1];
+            resultColor->g = sums.lane[2];
+            resultColor->r = sums.lane[3];
+            return true;
+
+        case BufferFormatBgra:
+            resultColor->r = sums.lane[1];
+            resultColor->g = sums.lane[2];
+            resultColor->b = sums.lane[3];
+            return true;
+
+        default:
+            return false;
+        }
+    }
+
+    int accumulateBuffer(
+            const unsigned char *buffer,
+            BufferFormat bufferFormat,
+            unsigned int pitch,
+            const QRect &rect,
+            ColorValue *resultColor) {
+        switch(bufferFormat) {
+        case BufferFormatArgb:
+            return accumulateBufferFormatArgb(buffer, pitch, rect, resultColor);
+
+        case BufferFormatAbgr:
+            return accumulateBufferFormatAbgr(buffer, pitch, rect, resultColor);
+
+        case BufferFormatRgba:
+            return accumulateBufferFormatRgba(buffer, pitch, rect, resultColor);
+
+        case BufferFormatBgra:
+            return accumulateBufferFormatBgra(buffer, pitch, rect, resultColor);
+
+        default:
+            return -1;
+        }
+    }
+
+    bool colorOffsets(BufferFormat bufferFormat, int *r, int *g, int *b) {
+        switch(bufferFormat) {
+        case BufferFormatArgb:
+            *r = 2; *g = 1; *b = 0;
+            return true;
+
+        case BufferFormatAbgr:
+            *r = 0; *g = 1; *b = 2;
+            return true;
+
+        case BufferFormatRgba:
+            *r = 3; *g = 2; *b = 1;
+            return true;
+
+        case BufferFormatBgra:
+            *r = 1; *g = 2; *b = 3;
+            return true;
+
+        default:
+            return false;
+        }
+    }
+
+    bool buildIntegralImage(
+            Grab::Calculations::IntegralImage *integralImage,
+            const unsigned char *buffer,
+            BufferFormat bufferFormat,
+            unsigned int pitch,
+            const QRect &rect) {
+        int offsetR, offsetG, offsetB;
+        if (!colorOffsets(bufferFormat, &offsetR, &offsetG, &offsetB))
+            return false;
+
+        const int stride = (rect.width() + 1) * 3;
+        integralImage->rect = rect;
+        integralImage->sums.resize(stride * (rect.height() + 1));
+
+        quint32 *sums = integralImage->sums.data();
+        memset(sums, 0, stride * sizeof(quint32));
+        for (int y = 0; y < rect.height(); ++y) {
+            const unsigned char *pixel = buffer + pitch * (rect.y() + y) + rect.x() * bytesPerPixel;
+            const quint32 *above = sums + stride * y;
+            quint32 *current = sums + stride * (y + 1);
+            quint32 rowR = 0, rowG = 0, rowB = 0;
+            current[0] = current[1] = current[2] = 0;
+            for (int x = 3; x < stride; x += 3) {
+                rowR += pixel[offsetR];
+                rowG += pixel[offsetG];
+                rowB += pixel[offsetB];
+                current[x]     = above[x]     + rowR;
+                current[x + 1] = above[x + 1] + rowG;
+                current[x + 2] = above[x + 2] + rowB;
+                pixel += bytesPerPixel;
+            }
+        }
+        return true;
+    }
+
+    /*!
+      Accumulates taken pixels of \a span on row \a y. Groups of four taken pixels go to
+      the kernels, the pixels left are summed here, so spans of any width are supported.
+    */
+    int accumulateSpan(
+            const unsigned char *buffer,
+            unsigned int pitch,
+            int y,
+            const Grab::Calculations::ScanlineSpan &span,
+            int step,
+            AccumulateLanesFunc accumulateLanes,
+            LaneSums *sums) {
+        const int bulkWidth = span.width - span.width % (4 * step);
+        int count = 0;
+        if (bulkWidth > 0) {
+            const QRect bulk(span.x, y, bulkWidth, 1);
+            count = step > 1 ? accumulateLanesStrided(buffer, pitch, bulk, step, sums) : accumulateLanes(buffer, pitch, bulk, sums);
+        } else {
+            LaneSums empty = {{0, 0, 0, 0}};
+            *sums = empty;
+        }
+
+        const unsigned char *pixel = buffer + pitch * y + (span.x + bulkWidth) * bytesPerPixel;
+        for (int x = bulkWidth; x < span.width; x += step) {
+            for (int lane = 0; lane < 4; ++lane)
+                sums->lane[lane] += pixel[lane];
+            count++;
+            pixel += bytesPerPixel * step;
+        }
+        return count;
+    }
+
+    bool calculateAvgColorsScanline(
+            QVector<QRgb> *results,
+            const unsigned char *buffer,
+            BufferFormat bufferFormat,
+            unsigned int pitch,
+            const Grab::Calculations::ScanlinePlan &plan) {
+        const int zonesCount = plan.zones.size();
+        QVarLengthArray<LaneSums, 256> zoneSums(zonesCount);
+        QVarLengthArray<int, 256> zoneCounts(zonesCount);
+        for (int i = 0; i < zonesCount; ++i) {
+            LaneSums empty = {{0, 0, 0, 0}};
+            zoneSums[i] = empty;
+            zoneCounts[i] = 0;
+        }
+
+        AccumulateLanesFunc accumulateLanes = s_accumulateLanes != NULL ? s_accumulateLanes : accumulateLanesScalar;
+        const int rowsCount = plan.rowOffsets.size() - 1;
+        for (int row = 0; row < rowsCount; ++row) {
+            const int y = plan.top + row;
+            for (int s = plan.rowOffsets[row]; s < plan.rowOffsets[row + 1]; ++s) {
+                const Grab::Calculations::ScanlineSpan &span = plan.spans[s];
+                LaneSums sums;
+                const int count = accumulateSpan(buffer, pitch, y, span, plan.step, accumulateLanes, &sums);
+                // pixels shared by overlapping zones are read once and added to all of them
+                for (int z = span.firstZone; z < span.firstZone + span.zonesCount; ++z) {
+                    const int zone = plan.spanZones[z];
+                    zoneCounts[zone] += count;
+                    LaneSums &zoneSum = zoneSums[zone];
+                    for (int lane = 0; lane < 4; ++lane)
+                        zoneSum.lane[lane] += sums.lane[lane];
+                }
+            }
+        }
+
+        results->resize(zonesCount);
+        for (int i = 0; i < zonesCount; ++i) {
+            ColorValue color = {0, 0, 0};
+            if (!colorFromLaneSums(bufferFormat, zoneSums[i], &color))
+                return false;
+
+            const int count = zoneCounts[i];
+            if ( count > 1 ) {
+                color.r = ( color.r / count) & 0xff;
+                color.g = ( color.g / count) & 0xff;
+                color.b = ( color.b / count) & 0xff;
+            }
+            (*results)[i] = qRgb(color.r, color.g, color.b);
+        }
+        return true;
+    }
+
+    bool calculateAvgColorsIntegral(
+            QVector<QRgb> *results,
+            const unsigned char *buffer,
+            BufferFormat bufferFormat,
+            unsigned int pitch,
+            const Grab::Calculations::ScanlinePlan &plan,
+            Grab::Calculations::IntegralImage *integralImage) {
+        const int zonesCount = plan.zones.size();
+        results->resize(zonesCount);
+        if (!plan.bounds.isValid()) {
+            int offsetR, offsetG, offsetB;
+            results->fill(qRgb(0, 0, 0));
+            return colorOffsets(bufferFormat, &offsetR, &offsetG, &offsetB);
+        }
+
+        if (!buildIntegralImage(integralImage, buffer, bufferFormat, pitch, plan.bounds))
+            return false;
+
+        const int stride = (plan.bounds.width() + 1) * 3;
+        const quint32 *sums = integralImage->sums.constData();
+        for (int i = 0; i < zonesCount; ++i) {
+            const QRect &zone = plan.zones[i];
+            if (!zone.isValid()) {
+                (*results)[i] = qRgb(0, 0, 0);
+                continue;
+            }
+
+            const int left = (zone.left() - plan.bounds.left()) * 3;
+            const int right = left + zone.width() * 3;
+            const quint32 *top = sums + stride * (zone.top() - plan.bounds.top());
+            const quint32 *bottom = top + stride * zone.height();
+
+            ColorValue color;
+            color.r = bottom[right]     - bottom[left]     - top[right]     + top[left];
+            color.g = bottom[right + 1] - bottom[left + 1] - top[right + 1] + top[left + 1];
+            color.b = bottom[right + 2] - bottom[left + 2] - top[right + 2] + top[left + 2];
+
+            const int count = zone.width() * zone.height();
+            if ( count > 1 ) {
+                color.r = ( color.r / count) & 0xff;
+                color.g = ( color.g / count) & 0xff;
+                color.b = ( color.b / count) & 0xff;
+            }
+            (*results)[i] = qRgb(color.r, color.g, color.b);
+        }
+        return true;
+    }
+
+    int accumulateBufferVectorized(
+            const unsigned char *buffer,
+            BufferFormat bufferFormat,
+            unsigned int pitch,
+            const QRect &rect,
+            ColorValue *resultColor) {
+        LaneSums sums;
+        const int count = s_accumulateLanes(buffer, pitch, rect, &sums);
+        return colorFromLaneSums(bufferFormat, sums, resultColor) ? count : -1;
+    }
 } // namespace
 
 namespace Grab {
     namespace Calculations {
-        QRgb calculateAvgColor(QRgb *result, const unsigned char *buffer, BufferFormat bufferFormat, unsigned int pitch, const QRect &rect ) {
+        QRgb calculateAvgColor(QRgb *result, const unsigned char *buffer, BufferFormat bufferFormat, unsigned int pitch, const QRect &rect, int step) {
 
             Q_ASSERT_X(rect.width() % 4 == 0, "average color calculation", "rect width should be aligned by 4 bytes");
 
             int count = 0; // count the amount of pixels taken into account
             ColorValue color = {0, 0, 0};
 
-            switch(bufferFormat) {
-            case BufferFormatArgb:
-                count = accumulateBufferFormatArgb(buffer, pitch, rect, &color);
-                break;
-
-            case BufferFormatAbgr:
-                count = accumulateBufferFormatAbgr(buffer, pitch, rect, &color);
-                break;
+            if (step > 1) {
+                LaneSums sums;
+                count = accumulateLanesStrided(buffer, pitch, rect, step, &sums);
+                if (!colorFromLaneSums(bufferFormat, sums, &color))
+                    count = -1;
+            } else if (s_accumulateLanes != NULL)
+                count = accumulateBufferVectorized(buffer, bufferFormat, pitch, rect, &color);
+            else
+                count = accumulateBuffer(buffer, bufferFormat, pitch, rect, &color);
 
-            case BufferFormatRgba:
-                count = accumulateBufferFormatRgba(buffer, pitch, rect, &color);
-                break;
-
-            case BufferFormatBgra:
-                count = accumulateBufferFormatBgra(buffer, pitch, rect, &color);
-                break;
-            default:
+            if (count < 0)
                 return -1;
-                break;
-            }
 
             if ( count > 1 ) {
                 color.r = ( color.r / count) & 0xff;
@@ -169,6 +813,110 @@ namespace Grab {
             return *result;
         }
 
+        AccumulationKernel bestAccumulationKernel() {
+            return s_bestKernel;
+        }
+
+        AccumulationKernel accumulationKernel() {
+            return s_activeKernel;
+        }
+
+        bool setAccumulationKernel(AccumulationKernel kernel) {
+            if (kernel > s_bestKernel)
+                return false;
+            s_activeKernel = kernel;
+            s_accumulateLanes = kernelFunc(kernel);
+            return true;
+        }
+
+        const char * accumulationKernelName(AccumulationKernel kernel) {
+            switch (kernel) {
+            case AccumulationKernelSse2:
+                return "SSE2";
+            case AccumulationKernelSsse3:
+                return "SSSE3";
+            case AccumulationKernelAvx2:
+                return "AVX2";
+            default:
+                return "scalar";
+            }
+        }
+
+        void buildScanlinePlan(ScanlinePlan *plan, const QVector<QRect> &zones, int step) {
+            plan->zones = zones;
+            plan->step = step > 1 ? step : 1;
+            plan->rowOffsets.clear();
+            plan->spans.clear();
+            plan->spanZones.clear();
+            plan->spansArea = 0;
+
+            QRect covered;
+            for (int i = 0; i < zones.size(); ++i) {
+                if (zones[i].isValid())
+                    covered = covered.united(zones[i]);
+            }
+
+            plan->bounds = covered;
+            plan->top = covered.top();
+            if (!covered.isValid())
+                return;
+
+            QVector<int> rowZones;
+            QVector<int> edges;
+            plan->rowOffsets.reserve(covered.height() + 1);
+            for (int y = covered.top(); y <= covered.bottom(); ++y) {
+                const int rowStart = plan->spans.size();
+                plan->rowOffsets.append(rowStart);
+                // with step > 1 zones share pixels only if they take the same columns
+                for (int phase = 0; phase < plan->step; ++phase) {
+                    rowZones.clear();
+                    for (int i = 0; i < zones.size(); ++i) {
+                        const QRect &zone = zones[i];
+                        if (!zone.isValid() || y < zone.top() || y > zone.bottom())
+                            continue;
+                        if ((y - zone.top()) % plan->step != 0 || columnPhase(zone.left(), plan->step) != phase)
+                            continue;
+                        rowZones.append(i);
+                    }
+                    if (!rowZones.isEmpty())
+                        appendRowSpans(plan, zones, rowZones, &edges);
+                }
+                std::sort(plan->spans.begin() + rowStart, plan->spans.end(), spanIsLess);
+            }
+            plan->rowOffsets.append(plan->spans.size());
+        }
+
+        bool calculateAvgColors(QVector<QRgb> *results, const unsigned char *buffer, BufferFormat bufferFormat, unsigned int pitch, const ScanlinePlan &plan, IntegralImage *integralImage) {
+            const bool useIntegralImage = s_zoneAveraging == ZoneAveragingIntegralImage
+                    || (s_zoneAveraging == ZoneAveragingAuto && isIntegralImagePreferred(plan));
+            if (!useIntegralImage)
+                return calculateAvgColorsScanline(results, buffer, bufferFormat, pitch, plan);
+
+            if (integralImage != NULL)
+                return calculateAvgColorsIntegral(results, buffer, bufferFormat, pitch, plan, integralImage);
+
+            IntegralImage temporary;
+            return calculateAvgColorsIntegral(results, buffer, bufferFormat, pitch, plan, &temporary);
+        }
+
+        bool isIntegralImagePreferred(const ScanlinePlan &plan) {
+            if (!plan.bounds.isValid() || plan.step > 1)
+                return false;
+            const qint64 boundsArea = qint64(plan.bounds.width()) * plan.bounds.height();
+            const qint64 accumulationCost = plan.spansArea
+                    + qint64(plan.spans.size()) * SpanCost
+                    + qint64(plan.spanZones.size()) * SpanZoneCost;
+            return accumulationCost >= boundsArea * IntegralImagePixelCost;
+        }
+
+        ZoneAveraging zoneAveraging() {
+            return s_zoneAveraging;
+        }
+
+        void setZoneAveraging(ZoneAveraging zoneAveraging) {
+            s_zoneAveraging = zoneAveraging;
+        }
+
         QRgb calculateAvgColor(QList<QRgb> *colors) {
             int r=0, g=0, b=0;
             const int size = colors->size();
@@ -24,7 +24,11 @@ HEADERS += \
     include/QtGrabber.hpp \
     include/GrabberBase.hpp \
     include/ColorProvider.hpp \
-    include/GrabberContext.hpp
+    include/GrabberContext.hpp \
+    include/SpscSlot.hpp \
+    include/FrameBufferArena.hpp \
+    include/FrameRecording.hpp \
+    include/ReplayGrabber.hpp
 
 SOURCES += \
     calculations.cpp \
@@ -32,6 +36,9 @@ SOURCES += \
     QtGrabberEachWidget.cpp \
     QtGrabber.cpp \
     GrabberBase.cpp \
+    FrameBufferArena.cpp \
+    FrameRecording.cpp \
+    ReplayGrabber.cpp \
     include/ColorProvider.cpp
 
 win32 {
@@ -64,6 +71,15 @@ win32 {
             WinDXUtils.cpp
 }
 
+unix {
+    HEADERS += \
+            ../common/FrameSourceDefs.hpp \
+            include/FrameSourceGrabber.hpp
+
+    SOURCES += \
+            FrameSourceGrabber.cpp
+}
+
 macx {
     #QMAKE_LFLAGS += -F/System/Library/Frameworks
 
@@ -84,8 +100,10 @@ macx {
 
 unix:!macx {
     HEADERS += \
-            include/X11Grabber.hpp
+            include/X11Grabber.hpp \
+            include/XcbShmGrabber.hpp
 
     SOURCES += \
-            X11Grabber.cpp
+            X11Grabber.cpp \
+            XcbShmGrabber.cpp
 }
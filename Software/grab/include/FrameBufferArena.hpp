@@ -0,0 +1,95 @@
+/*
+ * FrameBufferArena.hpp
+ *
+ *  Created on: 18.10.2026
+ *     Project: Lightpack
+ *
+ *  Copyright (c) 2026 Lightpack contributors
+ *
+ *  Lightpack a USB content-driving ambient lighting system
+ *
+ *  Lightpack is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Lightpack is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <QHash>
+#include <QVector>
+#include <QMutex>
+
+/*!
+  Handle of a buffer acquired from \a FrameBufferArena
+*/
+struct FrameBuffer {
+    FrameBuffer()
+        : ptr(NULL)
+        , size(0)
+    {}
+    unsigned char * ptr;
+    size_t size; // capacity, at least the requested size
+
+    bool isNull() const { return ptr == NULL; }
+};
+
+/*!
+  Pool of frame buffers aligned for SIMD loads. Released buffers are kept in free lists per
+  size class and handed out again, so switching screen resolution back and forth doesn't
+  hit the allocator. Large buffers are hugepage aligned and advised as such where supported.
+*/
+class FrameBufferArena
+{
+public:
+    enum {
+        Alignment = 64,
+        HugePageSize = 2 * 1024 * 1024,
+        // released buffers over this amount are freed right away
+        MaxFreeBytes = 256 * 1024 * 1024
+    };
+
+    FrameBufferArena();
+    ~FrameBufferArena();
+
+    /*!
+      \return buffer of at least \a size bytes, null buffer if allocation failed
+    */
+    FrameBuffer acquire(size_t size);
+    /*!
+      Returns buffer to the free list of its size class, only \a FrameBuffer#ptr is used to find it
+    */
+    void release(const FrameBuffer &buffer);
+
+    /*!
+      Frees all released buffers
+    */
+    void trim();
+
+    size_t allocatedBytes() const;
+    size_t inUseBytes() const;
+    size_t peakAllocatedBytes() const;
+
+private:
+    static size_t sizeClassOf(size_t size);
+    static unsigned char * allocateAligned(size_t size);
+    static void freeAligned(unsigned char * ptr);
+
+    QHash<size_t, QVector<unsigned char *> > _freeLists;
+    QHash<unsigned char *, size_t> _inUse;
+    size_t _allocatedBytes;
+    size_t _freeBytes;
+    size_t _peakAllocatedBytes;
+    mutable QMutex _mutex;
+
+    Q_DISABLE_COPY(FrameBufferArena)
+};
@@ -0,0 +1,150 @@
+/*
+ * FrameRecording.hpp
+ *
+ *  Created on: 18.10.2026
+ *     Project: Lightpack
+ *
+ *  Copyright (c) 2026 Lightpack contributors
+ *
+ *  Lightpack a USB content-driving ambient lighting system
+ *
+ *  Lightpack is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Lightpack is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <QString>
+#include <QRect>
+#include <QVector>
+#include <QFile>
+#include <QMutex>
+#include <QAtomicInt>
+#include "../common/BufferFormat.h"
+
+/*!
+  Image of one screen in a recorded frame
+*/
+struct RecordedScreen {
+    RecordedScreen()
+        : format(BufferFormatUnknown)
+        , bytesPerLine(0)
+        , data(NULL)
+        , dataSize(0)
+    {}
+    QRect rect;
+    BufferFormat format;
+    int bytesPerLine; // 0 if rows are exactly width * 4 bytes long
+    const unsigned char * data;
+    size_t dataSize;
+};
+
+/*!
+  Frame recording file layout, all fields are in host byte order:
+  FileHeader, then for every frame FrameHeader followed by ScreenHeader and image data of each
+  screen. Image equal to the one of the same screen in the previous frame is not stored again.
+*/
+namespace FrameRecordingFormat
+{
+const char Magic[4] = { 'P', 'R', 'F', 'R' };
+const quint32 Version = 1;
+
+enum ScreenFlags {
+    ScreenRepeated = 0x1 // no data, image is the same as in the previous frame
+};
+
+struct FileHeader {
+    char magic[4];
+    quint32 version;
+};
+
+struct FrameHeader {
+    qint64 timestampNs;
+    quint32 screensCount;
+    quint32 reserved;
+};
+
+struct ScreenHeader {
+    qint32 x, y, width, height;
+    qint32 format;
+    quint32 flags;
+    qint32 bytesPerLine;
+    quint32 reserved;
+    quint64 dataSize;
+};
+}
+
+/*!
+  Writes grabbed frames to a recording file. Frames are recorded from the grabbers thread while
+  recording is started and stopped from the GUI thread.
+*/
+class FrameRecorder
+{
+public:
+    FrameRecorder();
+    ~FrameRecorder();
+
+    bool start(const QString &path);
+    void stop();
+    bool isRecording() const { return _isRecording.loadAcquire() != 0; }
+
+    /*!
+      \param timestampNs monotonic time the frame was grabbed at
+    */
+    void record(qint64 timestampNs, const QVector<RecordedScreen> &screens);
+
+    quint32 recordedFramesCount() const { return _recordedFramesCount; }
+
+private:
+    void stopLocked();
+
+    QFile _file;
+    QVector<QByteArray> _lastImages;
+    quint32 _recordedFramesCount;
+    QAtomicInt _isRecording;
+    QMutex _mutex;
+};
+
+/*!
+  Memory mapped frame recording, images point straight into the mapping
+*/
+class FrameRecording
+{
+public:
+    FrameRecording();
+    ~FrameRecording();
+
+    bool open(const QString &path);
+    void close();
+    bool isOpen() const { return _mapping != NULL; }
+
+    int framesCount() const { return _frames.size(); }
+    qint64 timestampNs(int frameIndex) const { return _frames[frameIndex].timestampNs; }
+    /*!
+      Screens of the frame, valid until the recording is closed
+    */
+    QVector<RecordedScreen> screens(int frameIndex) const;
+
+private:
+    struct FrameEntry {
+        qint64 timestampNs;
+        int firstScreen;
+        int screensCount;
+    };
+
+    QFile _file;
+    uchar * _mapping;
+    QVector<FrameEntry> _frames;
+    QVector<RecordedScreen> _screens;
+};
@@ -0,0 +1,125 @@
+/*
+ * FrameSourceGrabber.hpp
+ *
+ *  Created on: 18.10.2026
+ *     Project: Lightpack
+ *
+ *  Copyright (c) 2026 Lightpack contributors
+ *
+ *  Lightpack a USB content-driving ambient lighting system
+ *
+ *  Lightpack is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Lightpack is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include "TimeredGrabber.hpp"
+#include "../src/enums.hpp"
+
+#ifdef FRAME_SOURCE_GRAB_SUPPORT
+
+#include <QPoint>
+#include "../common/FrameSourceDefs.hpp"
+
+/*!
+  Grabs raw frames written by another program to a named pipe or a POSIX shared memory ring,
+  see FrameSourceDefs.hpp for the protocol. The frame is placed on the desktop at \a setOrigin()
+  and zones are averaged from it as from a grabbed screen.
+*/
+class FrameSourceGrabber : public TimeredGrabber
+{
+    Q_OBJECT
+public:
+    FrameSourceGrabber(QObject *parent, GrabberContext *context);
+    virtual ~FrameSourceGrabber();
+
+    DECLARE_GRABBER_NAME("FrameSourceGrabber")
+
+public slots:
+    /*!
+      \param source path of a named pipe, or shared memory object name prefixed with "shm:"
+    */
+    bool openSource(const QString &source);
+    void setOrigin(const QPoint &origin);
+
+protected:
+    virtual GrabResult grabScreens();
+    virtual bool reallocate(const QList<ScreenInfo> &screens);
+    virtual QList<ScreenInfo> * screensWithWidgets(QList<ScreenInfo> *result, const QList<GrabZone> &grabZones);
+    virtual bool isGrabbedFrameIntact() const;
+
+private:
+    struct FrameFormat {
+        FrameFormat()
+            : width(0)
+            , height(0)
+            , bytesPerLine(0)
+            , format(BufferFormatUnknown)
+        {}
+        int width;
+        int height;
+        int bytesPerLine;
+        BufferFormat format;
+
+        bool isValid() const;
+        size_t frameSize() const { return static_cast<size_t>(bytesPerLine) * height; }
+        bool operator!= (const FrameFormat &other) const {
+            return width != other.width || height != other.height || bytesPerLine != other.bytesPerLine || format != other.format;
+        }
+    };
+
+    void closeSource();
+    void pollSource();
+    void readPipe();
+    bool readPipeHeader();
+    void setPipeFormat(const FrameFormat &format);
+    void freePipeBuffers();
+    bool mapShm();
+    void unmapShm();
+    void pollShm();
+    bool isShmLayoutChanged() const;
+
+private:
+    enum SourceType {
+        NoSource,
+        PipeSource,
+        ShmSource
+    };
+
+    QString _source;
+    SourceType _sourceType;
+    int _fd;
+    QPoint _origin;
+    FrameFormat _format;
+    const unsigned char *_frame;
+    bool _isFrameUpdated;
+
+    // named pipe, frames are read into the back buffer and swapped when complete
+    QByteArray _headerLine;
+    bool _isHeaderRead;
+    FrameBuffer _pipeBuffers[2];
+    int _frontBuffer;
+    size_t _backBufferFilled;
+
+    // shared memory ring, layout is validated by mapShm() and kept here as the producer may rewrite the header
+    unsigned char *_shm;
+    size_t _shmSize;
+    quint32 _slotsCount;
+    quint64 _dataOffset;
+    quint64 _slotSize;
+    quint64 _lastSequence;
+};
+
+#endif // FRAME_SOURCE_GRAB_SUPPORT
@@ -28,6 +28,7 @@
 #include <QSharedPointer>
 #include <QColor>
 #include <QTimer>
+#include <QAtomicInt>
 #include "../common/defs.h"
 #include "../src/GrabWidget.hpp"
 #include "calculations.hpp"
@@ -36,6 +37,7 @@
 enum GrabResult {
     GrabResultOk,
     GrabResultFrameNotReady,
+    GrabResultFrameUnchanged, // nothing under grab widgets changed, previous colors are still valid
     GrabResultError
 };
 
@@ -53,11 +55,13 @@ struct ScreenInfo {
 struct GrabbedScreen {
     GrabbedScreen()
         : imgFormat(BufferFormatUnknown)
+        , bytesPerLine(0)
         , associatedData(NULL)
     {}
     unsigned char * imgData;
     size_t imgDataSize;
     BufferFormat imgFormat;
+    int bytesPerLine; // 0 if rows are exactly screen width * 4 bytes long
     ScreenInfo screenInfo;
     void * associatedData;
 };
@@ -79,14 +83,28 @@ public:
 
     /*!
      \param parent standart Qt-specific owner
-     \param grabResult \code QList \endcode to write results of grabbing to
-     \param grabWidgets List of GrabWidgets
+     \param grabberContext grab zones, result slot and buffers shared with \a GrabManager
     */
     GrabberBase(QObject * parent, GrabberContext * grabberContext);
     virtual ~GrabberBase() {}
 
     virtual const char * name() const = 0;
 
+    /*!
+      Number of frames skipped because the screen content under widgets didn't change
+    */
+    quint32 skippedFramesCount() const { return static_cast<quint32>(_skippedFramesCount.load()); }
+
+    /*!
+      Geometry of \a widget in desktop coordinates, the same one grab() averages
+    */
+    static QRect grabRectOfWidget(const GrabWidget *widget);
+
+    /*!
+      The same as grabRectOfWidget() for a zone stored in settings, no widget required
+    */
+    static QRect grabRectOfGeometry(const QRect &geometry);
+
 public slots:
     virtual void startGrabbing() = 0;
     virtual void stopGrabbing() = 0;
@@ -111,17 +129,24 @@ protected slots:
     virtual bool reallocate(const QList< ScreenInfo > &grabScreens) = 0;
 
     /*!
-     * Get all screens grab widgets lies on.
+     * Get all screens grab zones lies on.
      * \param result
-     * \param grabWidgets
+     * \param grabZones snapshot of grab widgets, see \a GrabberContext#grabZones()
      * \return
      */
-    virtual QList< ScreenInfo > * screensWithWidgets(QList< ScreenInfo > * result, const QList<GrabWidget *> &grabWidgets) = 0;
+    virtual QList< ScreenInfo > * screensWithWidgets(QList< ScreenInfo > * result, const QList<GrabZone> &grabZones) = 0;
 
     virtual bool isReallocationNeeded(const QList< ScreenInfo > &grabScreens) const;
 
+    /*!
+      Checked after colors are calculated, grabbers reading images another process may
+      overwrite meanwhile drop the frame by returning false.
+    */
+    virtual bool isGrabbedFrameIntact() const { return true; }
+
 protected:
     const GrabbedScreen * screenOfRect(const QRect &rect) const;
+    int screenIndexOfRect(const QRect &rect) const;
 
 signals:
     void frameGrabAttempted(GrabResult grabResult);
@@ -134,6 +159,38 @@ signals:
 protected:
     GrabberContext *_context;
     GrabResult _lastGrabResult;
+    QAtomicInt _skippedFramesCount;
     QList<GrabbedScreen> _screensWithWidgets;
 
+private:
+    /*!
+      Zone geometry resolved against grabbed screens, rebuilt only when zones or screens change
+    */
+    void buildZoneMap();
+    void recordScreens(qint64 timestampNs);
+
+    struct ZoneMapEntry {
+        ZoneMapEntry()
+            : screenIndex(-1)
+            , isEnabled(false)
+        {}
+        int screenIndex;
+        QRect rect; // in screen coordinates, width aligned by 4
+        bool isEnabled;
+    };
+
+    QVector<ZoneMapEntry> _zoneMap;
+    bool _isZoneMapDirty;
+    int _grabZonesGeneration;
+
+    /*!
+      Zones of every grabbed screen bucketed by rows, rebuilt only when zones change
+    */
+    QVector<Grab::Calculations::ScanlinePlan> _scanlinePlans;
+    QVector<Grab::Calculations::IntegralImage> _integralImages;
+    QVector< QVector<QRect> > _screenZones;
+    QVector< QVector<int> > _screenZoneWidgets;
+    QVector<QRgb> _zoneColors;
+    QList<GrabZone> _grabZones;
+
 };
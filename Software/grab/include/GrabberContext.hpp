@@ -29,79 +29,108 @@
 
 #include <QList>
 #include <QRgb>
-#include "GrabberBase.hpp"
+#include <QRect>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include "SpscSlot.hpp"
+#include "FrameBufferArena.hpp"
+#include "FrameRecording.hpp"
 
 class GrabWidget;
 
-struct AllocatedBuf {
-    AllocatedBuf()
-        : size(0)
-        , ptr(NULL)
-        , isAvail(true)
+/*!
+  Snapshot of a grab widget taken on the GUI thread, grabbers never touch widgets themselves
+*/
+struct GrabZone {
+    GrabZone()
+        : isAreaEnabled(false)
     {}
+    QRect rect;
+    bool isAreaEnabled;
 
-    size_t size;
-    unsigned char * ptr;
-    bool isAvail;
+    bool operator== (const GrabZone &other) const {
+        return other.rect == rect && other.isAreaEnabled == isAreaEnabled;
+    }
+};
+
+/*!
+  Zone colors of a grabbed frame along with the time spent in each grab stage
+*/
+struct GrabbedFrame {
+    GrabbedFrame()
+        : frameId(0)
+        , publishedNs(0)
+        , captureNs(0)
+        , computeNs(0)
+    {}
+    QList<QRgb> colors;
+    quint64 frameId;
+    qint64 publishedNs; // GrabberContext#clock time the frame was handed over
+    qint64 captureNs;
+    qint64 computeNs;
 };
 
 class GrabberContext {
 public:
     GrabberContext()
-    {}
-
-    ~GrabberContext(){
-//        releaseAllBufs();
-//        freeReleasedBufs();
+        : subsamplingStep(1)
+        , _grabZonesGeneration(0)
+        , _lastFrameId(0)
+    {
+        clock.start();
     }
 
-    unsigned char * queryBuf(size_t reqSize) {
-        AllocatedBuf *bestFitBuf = NULL;
-        for (int i = 0; i < _allocatedBufs.size(); ++i) {
-            if (_allocatedBufs[i]->isAvail
-                && _allocatedBufs[i]->size >= reqSize
-                && ( bestFitBuf == NULL
-                    || _allocatedBufs[i]->size < bestFitBuf->size))
-            {
-                bestFitBuf = _allocatedBufs[i];
-            }
-        }
-        if (bestFitBuf == NULL) {
-            bestFitBuf = new AllocatedBuf();
-            bestFitBuf->ptr = (unsigned char *)malloc(reqSize);
-
-            if (bestFitBuf->ptr == NULL)
-                return NULL;
-
-            bestFitBuf->size = reqSize;
-            _allocatedBufs.append(bestFitBuf);
-        }
-        return bestFitBuf->ptr;
+    void setGrabZones(const QList<GrabZone> &zones) {
+        QMutexLocker locker(&_grabZonesMutex);
+        _grabZones = zones;
+        _grabZonesGeneration.ref();
     }
 
-    void releaseAllBufs() {
-        for (QList<AllocatedBuf*>::const_iterator iter = _allocatedBufs.cbegin(); iter != _allocatedBufs.end(); ++iter) {
-            (*iter)->isAvail = true;
-        }
+    /*!
+      \param generation receives generation of the returned zones, see grabZonesGeneration()
+    */
+    QList<GrabZone> grabZones(int *generation = NULL) const {
+        QMutexLocker locker(&_grabZonesMutex);
+        if (generation)
+            *generation = _grabZonesGeneration.load();
+        return _grabZones;
     }
 
-    void freeReleasedBufs() {
-        for (QList<AllocatedBuf*>::iterator iter = _allocatedBufs.begin(); iter != _allocatedBufs.end(); ++iter) {
-            if ((*iter)->isAvail) {
-                AllocatedBuf *buf = *iter;
-                free(buf->ptr);
-                _allocatedBufs.removeAll(buf);
-                delete buf;
-            }
-        }
-    }
-public:
-    QList<GrabWidget *> *grabWidgets;
-    QList<QRgb> *grabResult;
+    /*!
+      Changes every time grab zones are set, grabbers use it to skip copying unchanged zones
+    */
+    int grabZonesGeneration() const { return _grabZonesGeneration.loadAcquire(); }
+
+    /*!
+      Ids of grabbed frames increase across grabber switches, called on the grabbers thread only
+    */
+    quint64 nextFrameId() { return ++_lastFrameId; }
 
+public:
+    /*!
+      Last grabbed frame, colors are in grab zones order, written by the grabbers thread
+    */
+    SpscSlot<GrabbedFrame> grabResult;
+    QAtomicInt subsamplingStep;
+    /*!
+      Monotonic clock shared by the threads of the grab pipeline to measure queueing delays
+    */
+    QElapsedTimer clock;
+    /*!
+      Aligned image buffers for grabbers which copy screens to memory they own
+    */
+    FrameBufferArena bufferArena;
+    /*!
+      Records grabbed screens of whatever grabber is active while recording is started
+    */
+    FrameRecorder frameRecorder;
 
 private:
-    QList<AllocatedBuf *> _allocatedBufs;
+    QList<GrabZone> _grabZones;
+    QAtomicInt _grabZonesGeneration;
+    mutable QMutex _grabZonesMutex;
+    quint64 _lastFrameId;
 };
 
 
@@ -0,0 +1,83 @@
+/*
+ * ReplayGrabber.hpp
+ *
+ *  Created on: 18.10.2026
+ *     Project: Lightpack
+ *
+ *  Copyright (c) 2026 Lightpack contributors
+ *
+ *  Lightpack a USB content-driving ambient lighting system
+ *
+ *  Lightpack is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Lightpack is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <QScopedPointer>
+#include <QElapsedTimer>
+#include "GrabberBase.hpp"
+#include "FrameRecording.hpp"
+
+QT_FORWARD_DECLARE_CLASS(QTimer)
+
+/*!
+  Feeds frames of a \a FrameRecording through the grab pipeline instead of grabbing the
+  desktop, at their original timing or as fast as possible. Every frame is grabbed exactly
+  once per pass even if replay falls behind, so runs are reproducible. The recording is
+  replayed in a loop.
+*/
+class ReplayGrabber : public GrabberBase
+{
+    Q_OBJECT
+public:
+    ReplayGrabber(QObject *parent, GrabberContext *context);
+    virtual ~ReplayGrabber();
+
+    DECLARE_GRABBER_NAME("ReplayGrabber")
+
+public slots:
+    bool openRecording(const QString &path);
+    /*!
+      \param isRealtime keep the recorded frame timing, otherwise replay as fast as possible
+    */
+    void setRealtime(bool isRealtime);
+
+    virtual void startGrabbing();
+    virtual void stopGrabbing();
+    virtual bool isGrabbingStarted() const;
+    /*!
+      Ignored, frames follow the recorded timing
+    */
+    virtual void setGrabInterval(int msec);
+
+protected slots:
+    virtual GrabResult grabScreens();
+    virtual bool reallocate(const QList<ScreenInfo> &screens);
+    virtual QList<ScreenInfo> * screensWithWidgets(QList<ScreenInfo> *result, const QList<GrabZone> &grabZones);
+
+private slots:
+    void onFrameDue();
+
+private:
+    void scheduleFrame();
+
+private:
+    FrameRecording m_recording;
+    QScopedPointer<QTimer> m_timer;
+    QElapsedTimer m_passTimer;
+    int m_frameIndex;
+    bool m_isRealtime;
+    bool m_isStarted;
+};
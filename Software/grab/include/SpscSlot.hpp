@@ -0,0 +1,78 @@
+/*
+ * SpscSlot.hpp
+ *
+ *  Project: Prismatik
+ *
+ *  Prismatik is a free, open-source software: you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as published
+ *  by the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Prismatik and Lightpack files is distributed in the hope that it will be
+ *  useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <QAtomicInt>
+
+/*!
+  Lock-free single-producer single-consumer slot holding the latest value only.
+
+  Three buffers rotate between the producer, the consumer and the middle slot which is
+  swapped atomically. Producer never waits for the consumer, stale values are overwritten.
+*/
+template <typename T>
+class SpscSlot
+{
+public:
+    SpscSlot()
+        : _writeIndex(0)
+        , _middle(1)
+        , _readIndex(2)
+    {}
+
+    /*!
+      Buffer owned by the producer, fill it and call publish()
+    */
+    T & writeBuffer() { return _buffers[_writeIndex]; }
+
+    void publish() {
+        _writeIndex = _middle.fetchAndStoreOrdered(_writeIndex | FreshFlag) & IndexMask;
+    }
+
+    /*!
+      Takes the latest published value if there is one
+      \return true if readBuffer() now holds a value which wasn't consumed yet
+    */
+    bool consume() {
+        if ((_middle.loadAcquire() & FreshFlag) == 0)
+            return false;
+        _readIndex = _middle.fetchAndStoreOrdered(_readIndex) & IndexMask;
+        return true;
+    }
+
+    /*!
+      Buffer owned by the consumer, valid until the next consume()
+    */
+    const T & readBuffer() const { return _buffers[_readIndex]; }
+
+private:
+    enum {
+        IndexMask = 0x3,
+        FreshFlag = 0x4
+    };
+
+    T _buffers[3];
+    int _writeIndex;
+    QAtomicInt _middle;
+    int _readIndex;
+
+    Q_DISABLE_COPY(SpscSlot)
+};
@@ -32,23 +32,57 @@
 #include "../src/debug.h"
 
 QT_FORWARD_DECLARE_CLASS(QTimer)
+QT_FORWARD_DECLARE_CLASS(QSocketNotifier)
 
+/*!
+  Grabs frames at absolute deadlines on the monotonic clock, so time spent in grab() doesn't
+  shift the next frame. If grabbing falls behind, missed deadlines are skipped instead of
+  being grabbed back to back. On Linux deadlines are armed with timerfd, elsewhere with a
+  precise single shot QTimer.
+*/
 class TimeredGrabber : public GrabberBase
 {
     Q_OBJECT
 public:
     TimeredGrabber(QObject * parent, GrabberContext *context);
-    virtual ~TimeredGrabber() {}
+    virtual ~TimeredGrabber();
 
     virtual const char * name() const = 0;
+
+    /*!
+      Deadlines skipped because grabbing didn't keep up with the interval
+    */
+    quint32 missedDeadlinesCount() const { return static_cast<quint32>(m_missedDeadlinesCount.load()); }
+
 public slots:
     virtual void startGrabbing();
     virtual void stopGrabbing();
     virtual bool isGrabbingStarted() const;
     virtual void setGrabInterval(int msec);
+    /*!
+      Fractional frame rate, e.g. 23.976 or 59.94
+    */
+    void setGrabFps(double fps);
+
+private slots:
+    void onDeadline();
+
+private:
+    void setGrabIntervalNs(qint64 intervalNs);
+    void armTimer();
+    void disarmTimer();
+    static qint64 monotonicNs();
 
 protected:
     QScopedPointer<QTimer> m_timer;
+
+private:
+    QScopedPointer<QSocketNotifier> m_timerNotifier;
+    int m_timerFd;
+    bool m_isStarted;
+    qint64 m_intervalNs;
+    qint64 m_deadlineNs;
+    QAtomicInt m_missedDeadlinesCount;
 };
 
 #endif // TIMEREDGRABBER_HPP
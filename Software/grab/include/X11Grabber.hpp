@@ -49,12 +49,32 @@ public:
 protected:
     virtual GrabResult grabScreens();
     virtual bool reallocate(const QList<ScreenInfo> &screens);
-    virtual QList<ScreenInfo> * screensWithWidgets(QList<ScreenInfo> *result, const QList<GrabWidget *> &grabWidgets);
+    virtual QList<ScreenInfo> * screensWithWidgets(QList<ScreenInfo> *result, const QList<GrabZone> &grabZones);
 
 private:
     void freeScreens();
+    void initDamage();
+    void initRandr();
+    void processEvents();
+    void updateMonitors();
+    void fetchDamage(QList< QList<QRect> > *damagedRects);
+    bool isZoneDamaged(const QRect &rect) const;
 
 private:
     _XDisplay *_display;
+    bool _isDamageSupported;
+    bool _isRandrSupported;
+    int _randrEventBase;
+    bool _isMonitorsUpdateNeeded;
+    bool _isFullGrabNeeded;
+    QList<unsigned long> _damages;
+    unsigned long _damageRegion;
+    QList<bool> _lastAreaEnabled;
+    QList<QRect> _lastWidgetRects;
+    QList<ScreenInfo> _lastRegions;
+    // geometry of monitors (RandR CRTCs, or whole root windows without RandR) and X screens they belong to
+    QList<QRect> _monitorRects;
+    QList<int> _monitorScreens;
+    bool _isMonitorsChanged;
 };
 #endif // X11_GRAB_SUPPORT
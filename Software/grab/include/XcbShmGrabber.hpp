@@ -0,0 +1,70 @@
+/*
+ * XcbShmGrabber.hpp
+ *
+ *  Created on: 18.10.2026
+ *     Project: Lightpack
+ *
+ *  Copyright (c) 2026 Lightpack contributors
+ *
+ *  Lightpack a USB content-driving ambient lighting system
+ *
+ *  Lightpack is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Lightpack is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include "TimeredGrabber.hpp"
+#include "../src/enums.hpp"
+
+#ifdef XCB_SHM_GRAB_SUPPORT
+
+#include "../src/debug.h"
+
+struct xcb_connection_t;
+
+using namespace Grab;
+
+/*!
+  X11 grabber built on xcb-shm. Image requests for all screens are sent at once without
+  waiting for replies, and every screen has two shm segments: colors of frame N are
+  calculated while X server fills frame N + 1.
+*/
+class XcbShmGrabber : public TimeredGrabber
+{
+public:
+    XcbShmGrabber(QObject *parent, GrabberContext *context);
+    virtual ~XcbShmGrabber();
+
+    DECLARE_GRABBER_NAME("XcbShmGrabber")
+
+public slots:
+    virtual void stopGrabbing();
+
+protected:
+    virtual GrabResult grabScreens();
+    virtual bool reallocate(const QList<ScreenInfo> &screens);
+    virtual QList<ScreenInfo> * screensWithWidgets(QList<ScreenInfo> *result, const QList<GrabZone> &grabZones);
+
+private:
+    void freeScreens();
+    void discardRequestedFrame();
+    void requestFrame();
+
+private:
+    xcb_connection_t *_connection;
+    bool _isShmSupported;
+    bool _isFrameRequested;
+};
+#endif // XCB_SHM_GRAB_SUPPORT
@@ -28,12 +28,112 @@
 #include <QRect>
 #include <QRgb>
 #include <QList>
+#include <QVector>
 #include "../common/BufferFormat.h"
 
 namespace Grab {
     namespace Calculations {
 
-        QRgb calculateAvgColor(QRgb *result, const unsigned char *buffer, BufferFormat bufferFormat, unsigned int pitch, const QRect &rect );
+        /*!
+          Implementations of the pixel accumulation loop used by calculateAvgColor, ordered by
+          capability. The best one supported by the CPU is picked at startup, all of them
+          produce exactly the same results.
+        */
+        enum AccumulationKernel {
+            AccumulationKernelScalar,
+            AccumulationKernelSse2,
+            AccumulationKernelSsse3,
+            AccumulationKernelAvx2
+        };
+
+        /*!
+          Horizontal piece of a row covered by the same zones. Pixels x, x + step, .. before
+          x + width are taken, their sums are added to zones
+          spanZones[firstZone] .. spanZones[firstZone + zonesCount - 1] of the plan.
+        */
+        struct ScanlineSpan {
+            int x;
+            int width;
+            int firstZone;
+            int zonesCount;
+        };
+
+        /*!
+          Zones of one screen bucketed by rows. Spans of row (top + i) are
+          spans[rowOffsets[i]] .. spans[rowOffsets[i + 1] - 1], sorted by x, so the frame
+          buffer can be walked top to bottom once for all zones. Zones overlapping on a row
+          are split at their edges, so spans of a row take disjoint pixels and a pixel shared
+          by several zones is read once. With step > 1 zones taking different columns get
+          separate spans.
+        */
+        struct ScanlinePlan {
+            ScanlinePlan() : top(0), step(1), spansArea(0) {}
+
+            QVector<QRect> zones;
+            int top;
+            int step;
+            QVector<int> rowOffsets;
+            QVector<ScanlineSpan> spans;
+            QVector<int> spanZones;
+            QRect bounds;
+            // sum of spans widths
+            qint64 spansArea;
+        };
+
+        /*!
+          Per-channel summed-area table of \a rect with an extra zero row and column.
+          Channels are interleaved as r, g, b, so sum of r over rows [0, y) and columns
+          [0, x) of \a rect is sums[(y * (rect.width() + 1) + x) * 3]. 32-bit values wrap,
+          four-corner differences stay exact as long as a zone sum fits into 32 bits.
+        */
+        struct IntegralImage {
+            QRect rect;
+            QVector<quint32> sums;
+        };
+
+        enum ZoneAveraging {
+            ZoneAveragingAuto,
+            ZoneAveragingScanline,
+            ZoneAveragingIntegralImage
+        };
+
+        /*!
+          \param step subsampling step, only every step-th pixel of every step-th row is taken
+          into account. Step 2 is vectorized with the AVX2 kernel only, other steps > 1 are scalar.
+        */
+        QRgb calculateAvgColor(QRgb *result, const unsigned char *buffer, BufferFormat bufferFormat, unsigned int pitch, const QRect &rect, int step = 1);
         QRgb calculateAvgColor(QList<QRgb> *colors);
+
+        /*!
+          Rebuilds \a plan for \a zones given in buffer coordinates, invalid zones get no spans. With \a step > 1 zones are subsampled the
+          same way calculateAvgColor does, the integral image always uses every pixel.
+        */
+        void buildScanlinePlan(ScanlinePlan *plan, const QVector<QRect> &zones, int step = 1);
+        /*!
+          Calculates average colors of all zones of \a plan in one pass over \a buffer, either
+          by accumulating scanline spans or by four-corner lookups into an integral image built
+          in \a integralImage (a temporary one if NULL), see setZoneAveraging().
+          Results are the same as of calculateAvgColor called for every zone.
+          \return false if \a bufferFormat is not supported
+        */
+        bool calculateAvgColors(QVector<QRgb> *results, const unsigned char *buffer, BufferFormat bufferFormat, unsigned int pitch, const ScanlinePlan &plan, IntegralImage *integralImage = NULL);
+
+        /*!
+          Integral image pays off when overlapping zones cut rows into many short spans:
+          building it touches every pixel of the zones bounds once, while accumulation touches
+          covered pixels once but pays for every span and every zone a span is added to.
+        */
+        bool isIntegralImagePreferred(const ScanlinePlan &plan);
+        ZoneAveraging zoneAveraging();
+        void setZoneAveraging(ZoneAveraging zoneAveraging);
+
+        AccumulationKernel bestAccumulationKernel();
+        AccumulationKernel accumulationKernel();
+        /*!
+          Forces calculateAvgColor to use \a kernel, mostly for tests and benchmarks.
+          \return false if \a kernel is not supported by the CPU
+        */
+        bool setAccumulationKernel(AccumulationKernel kernel);
+        const char * accumulationKernelName(AccumulationKernel kernel);
     }
 }
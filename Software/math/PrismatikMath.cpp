@@ -34,6 +34,51 @@ namespace PrismatikMath
     const float refY = 100.000f;
     const float refZ = 108.883f;
 
+    namespace {
+        enum {
+            LinearTableSize = 4096,
+            LightnessTableSize = 4096
+        };
+
+        double srgbToLinear(unsigned value12bit)
+        {
+            double c = value12bit / 4095.0;
+            if ( c > 0.04045 )
+                return pow( (c + 0.055)/1.055, 2.4);
+            else
+                return c / 12.92;
+        }
+
+        /*!
+          Linear sRGB of 12bit channel values and L* of relative luminance sampled over [0, 1]
+        */
+        struct LabTables {
+            LabTables() {
+                for (int i = 0; i < LinearTableSize; ++i)
+                    linear[i] = srgbToLinear(i);
+
+                for (int i = 0; i < LightnessTableSize; ++i) {
+                    double y = double(i) / (LightnessTableSize - 1);
+                    if ( y > 0.008856 )
+                        y = pow(y, 1.0/3);
+                    else
+                        y = (7.787 * y) + (16.0 / 116);
+                    lightness[i] = round((116 * y) - 16);
+                }
+            }
+
+            double linear[LinearTableSize];
+            unsigned char lightness[LightnessTableSize];
+        };
+
+        const LabTables labTables;
+
+        inline double linearOf(unsigned value12bit)
+        {
+            return value12bit < LinearTableSize ? labTables.linear[value12bit] : srgbToLinear(value12bit);
+        }
+    }
+
     template<typename A, typename T>
     T withinRange(A x, T min, T max)
     {
@@ -54,6 +99,15 @@ namespace PrismatikMath
         eRgb.b = 4095 * pow(eRgb.b / 4095.0, gamma);
     }
 
+    void buildGammaTable(double gamma, unsigned short table[GammaTableSize])
+    {
+        // the same truncation as gammaCorrection() does
+        for (int i = 0; i < GammaTableSize; ++i) {
+            const unsigned value = 4095 * pow(i / 4095.0, gamma);
+            table[i] = value;
+        }
+    }
+
     void brightnessCorrection(unsigned int brightness, StructRgb & eRgb) {
 
         // brightness -- must be in percentage (0..100%)
@@ -128,7 +182,7 @@ namespace PrismatikMath
         return qRgb(r,g,b);
     }
 
-    StructRgb avgColor(const QList<StructRgb> &colors) {
+    StructRgb avgColor(const QVector<StructRgb> &colors) {
         StructRgb result;
         if (colors.size() > 0) {
             for (int i = 0; i < colors.size(); ++i) {
@@ -145,24 +199,9 @@ namespace PrismatikMath
 
     StructXyz toXyz(const StructRgb & rgb) {
         //12bit RGB from 0 to 4095
-        double r = ( rgb.r / 4095.0 );
-        double g = ( rgb.g / 4095.0 );
-        double b = ( rgb.b / 4095.0 );
-
-        if ( r > 0.04045 )
-            r = pow( (r + 0.055)/1.055, 2.4);
-        else
-            r = r / 12.92;
-
-        if ( g > 0.04045 )
-            g = pow( (g + 0.055)/1.055, 2.4);
-        else
-            g = g / 12.92;
-
-        if ( b > 0.04045 )
-            b = pow( (b + 0.055)/1.055, 2.4);
-        else
-            b = b / 12.92;
+        double r = linearOf(rgb.r);
+        double g = linearOf(rgb.g);
+        double b = linearOf(rgb.b);
 
         r = r * 100;
         g = g * 100;
@@ -177,6 +216,13 @@ namespace PrismatikMath
         return result;
     }
 
+    unsigned char lightness(const StructRgb &rgb) {
+        // relative luminance is Y of toXyz() scaled to [0, 1], L* depends on it only
+        const double y = linearOf(rgb.r) * 0.2126 + linearOf(rgb.g) * 0.7152 + linearOf(rgb.b) * 0.0722;
+        const int index = withinRange<double, int>(y * (LightnessTableSize - 1) + 0.5, 0, LightnessTableSize - 1);
+        return labTables.lightness[index];
+    }
+
     StructXyz toXyz(const StructLab &lab) {
         double y = (lab.l + 16.0) / 116.0;
         double x = lab.a / 500.0 + y;
@@ -26,13 +26,45 @@
 #pragma once
 
 #include <QList>
+#include <QVector>
 #include <QRgb>
 #include <cmath>
 #include "colorspace_types.h"
 
 namespace PrismatikMath
 {
+    enum { GammaTableSize = 4096 };
+
     void gammaCorrection(double gamma, StructRgb &);
+    /*!
+      Fills \a table with gammaCorrection() results for every 12bit value
+    */
+    void buildGammaTable(double gamma, unsigned short table[GammaTableSize]);
+    /*!
+      gammaCorrection() with the table built by buildGammaTable(), values above 12bit are clamped
+    */
+    inline void gammaCorrection(const unsigned short table[GammaTableSize], StructRgb & eRgb)
+    {
+        eRgb.r = table[eRgb.r < GammaTableSize ? eRgb.r : GammaTableSize - 1];
+        eRgb.g = table[eRgb.g < GammaTableSize ? eRgb.g : GammaTableSize - 1];
+        eRgb.b = table[eRgb.b < GammaTableSize ? eRgb.b : GammaTableSize - 1];
+    }
+    /*!
+      Drops 12bit \a value to 8bit adding the 4 bits dropped last time from \a residual and
+      storing the ones dropped now there, so the average of 16 frames of a value below 4080
+      is exactly value / 16. When the sum doesn't fit into 12bit 255 is returned and
+      \a residual is reset.
+    */
+    inline unsigned ditherTo8bit(unsigned value, unsigned char &residual)
+    {
+        const unsigned sum = value + residual;
+        if (sum > 4095) {
+            residual = 0;
+            return 255;
+        }
+        residual = sum & 0x0f;
+        return sum >> 4;
+    }
     void brightnessCorrection(unsigned int brightness, StructRgb &);
     void maxCorrection(unsigned int max, StructRgb &);
     int getValueHSV(const QRgb rgb);
@@ -41,7 +73,11 @@ namespace PrismatikMath
     int min(const QRgb);
     QRgb withValueHSV(const QRgb, int);
     QRgb withChromaHSV(const QRgb, int);
-    StructRgb avgColor(const QList<StructRgb> &);
+    StructRgb avgColor(const QVector<StructRgb> &);
+    /*!
+      L* of toLab(rgb) computed with lookup tables, differs from it by 1 at most
+    */
+    unsigned char lightness(const StructRgb &);
     StructXyz toXyz(const StructRgb &);
     StructXyz toXyz(const StructLab &);
     StructLab toLab(const StructRgb &);
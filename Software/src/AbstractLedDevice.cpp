@@ -28,11 +28,20 @@
 #include "colorspace_types.h"
 #include "PrismatikMath.hpp"
 #include "Settings.hpp"
+#include "FrameTracer.hpp"
+#include <QDir>
 
 #if defined _MSC_VER
 using PrismatikMath::round;
 #endif
 
+void AbstractLedDevice::setFrameColors(const QList<QRgb> & colors, quint64 frameId) {
+    FrameTraceScope trace("device setColors", frameId);
+    m_frameId = frameId;
+    setColors(colors);
+    m_frameId = 0;
+}
+
 void AbstractLedDevice::setGamma(double value) {
     m_gamma = value;
     setColors(m_colorsSaved);
@@ -56,12 +65,24 @@ void AbstractLedDevice::setMinimumLuminosityThresholdEnabled(bool value) {
 void AbstractLedDevice::updateWBAdjustments(const QList<WBAdjustment> &coefs) {
     m_wbAdjustments.clear();
     m_wbAdjustments.append(coefs);
+    m_isCorrectionTablesDirty = true;
     setColors(m_colorsSaved);
 }
 
 void AbstractLedDevice::updateDeviceSettings()
 {
     using namespace SettingsScope;
+
+    // relative paths are relative to the directory of profiles and caches
+    const QString colorLut = Settings::getDeviceColorLut();
+    const QDir applicationDir(Settings::getApplicationDirPath());
+    if (colorLut.isEmpty())
+        m_colorLut.clear();
+    else if (applicationDir.absoluteFilePath(colorLut) != m_colorLut.path())
+        m_colorLut.load(applicationDir.absoluteFilePath(colorLut), applicationDir.filePath("LutCache"));
+
+    m_isDitheringEnabled = Settings::isDeviceDitheringEnabled();
+
     setGamma(Settings::getDeviceGamma());
     setBrightness(Settings::getDeviceBrightness());
     setLuminosityThreshold(Settings::getLuminosityThreshold());
@@ -70,38 +91,128 @@ void AbstractLedDevice::updateDeviceSettings()
 }
 
 /*!
-  Modifies colors according to gamma, luminosity threshold, white balance and brightness settings
-  All modifications are made over extended 12bit RGB, so \code outColors \endcode will contain 12bit
-  RGB instead of 8bit.
+  Tabulates normalization to 12bit, white balance and gamma of every LED for every 8bit channel
+  value, so results are identical to applying these steps to every frame.
+  Gamma is left out when a 3D LUT has to be applied before it, brightness is left out when
+  the LUT or the luminosity threshold has to be applied before it.
+  Devices assign m_gamma and m_brightness directly, so values are compared here every frame.
 */
-void AbstractLedDevice::applyColorModifications(const QList<QRgb> &inColors, QList<StructRgb> &outColors) {
+void AbstractLedDevice::updateCorrectionTables(int ledsCount, bool isGammaIncluded, bool isBrightnessIncluded) {
 
-    bool isApplyWBAdjustments = m_wbAdjustments.count() == inColors.count();
+    if (m_gammaTableValue != m_gamma) {
+        PrismatikMath::buildGammaTable(m_gamma, m_gammaTable);
+        m_gammaTableValue = m_gamma;
+        m_isCorrectionTablesDirty = true;
+    }
 
-    for(int i = 0; i < inColors.count(); i++) {
+    const int brightness = isBrightnessIncluded ? m_brightness : -1;
+    if (!m_isCorrectionTablesDirty
+            && m_correctionTables.size() == ledsCount * 3 * 256
+            && m_isGammaInCorrectionTables == isGammaIncluded
+            && m_isBrightnessInCorrectionTables == isBrightnessIncluded
+            && m_correctionTablesBrightness == brightness)
+        return;
 
-        //renormalize to 12bit
-        double k = 4095/255.0;
-        outColors[i].r = qRed(inColors[i])   * k;
-        outColors[i].g = qGreen(inColors[i]) * k;
-        outColors[i].b = qBlue(inColors[i])  * k;
+    const bool isApplyWBAdjustments = m_wbAdjustments.count() == ledsCount;
+    m_correctionTables.resize(ledsCount * 3 * 256);
+    unsigned short *table = m_correctionTables.data();
+    for (int i = 0; i < ledsCount; ++i) {
+        for (int value = 0; value < 256; ++value) {
+            //renormalize to 12bit
+            double k = 4095/255.0;
+            StructRgb rgb;
+            rgb.r = rgb.g = rgb.b = value * k;
+
+            if (isApplyWBAdjustments) {
+                rgb.r *= m_wbAdjustments[i].red;
+                rgb.g *= m_wbAdjustments[i].green;
+                rgb.b *= m_wbAdjustments[i].blue;
+            }
 
-        if (isApplyWBAdjustments) {
-            outColors[i].r *= m_wbAdjustments[i].red;
-            outColors[i].g *= m_wbAdjustments[i].green;
-            outColors[i].b *= m_wbAdjustments[i].blue;
+            if (isGammaIncluded)
+                PrismatikMath::gammaCorrection(m_gammaTable, rgb);
+
+            if (isBrightnessIncluded)
+                PrismatikMath::brightnessCorrection(m_brightness, rgb);
+
+            table[value] = rgb.r;
+            table[256 + value] = rgb.g;
+            table[512 + value] = rgb.b;
         }
+        table += 3 * 256;
+    }
+
+    m_isCorrectionTablesDirty = false;
+    m_isGammaInCorrectionTables = isGammaIncluded;
+    m_isBrightnessInCorrectionTables = isBrightnessIncluded;
+    m_correctionTablesBrightness = brightness;
+}
 
-        PrismatikMath::gammaCorrection(m_gamma, outColors[i]);
+void AbstractLedDevice::updateBrightnessTable() {
+    if (m_brightnessTableValue == m_brightness)
+        return;
+
+    for (int i = 0; i < PrismatikMath::GammaTableSize; ++i) {
+        StructRgb rgb;
+        rgb.r = i;
+        PrismatikMath::brightnessCorrection(m_brightness, rgb);
+        m_brightnessTable[i] = rgb.r;
     }
+    m_brightnessTableValue = m_brightness;
+}
 
-    StructLab avgColor = PrismatikMath::toLab(PrismatikMath::avgColor(outColors));
+void AbstractLedDevice::applyBrightnessTable(StructRgb &rgb) const {
+    rgb.r = m_brightnessTable[qMin<unsigned>(rgb.r, PrismatikMath::GammaTableSize - 1)];
+    rgb.g = m_brightnessTable[qMin<unsigned>(rgb.g, PrismatikMath::GammaTableSize - 1)];
+    rgb.b = m_brightnessTable[qMin<unsigned>(rgb.b, PrismatikMath::GammaTableSize - 1)];
+}
 
-    for (int i = 0; i < outColors.count(); ++i) {
-        StructLab lab = PrismatikMath::toLab(outColors[i]);
-        int dl = m_luminosityThreshold - lab.l;
+/*!
+  Modifies colors according to white balance, 3D LUT, gamma, luminosity threshold and brightness settings
+  All modifications are made over extended 12bit RGB, so \code outColors \endcode will contain 12bit
+  RGB instead of 8bit.
+*/
+void AbstractLedDevice::applyColorModifications(const QList<QRgb> &inColors, QVector<StructRgb> &outColors) {
+
+    // no LED is below zero threshold, Lab isn't needed at all then
+    const bool isThresholdApplied = m_luminosityThreshold > 0;
+    const bool isLutApplied = m_colorLut.isLoaded();
+    const bool isBrightnessTabulated = !isThresholdApplied && !isLutApplied;
+    updateCorrectionTables(inColors.count(), !isLutApplied, isBrightnessTabulated);
+    if (!isBrightnessTabulated)
+        updateBrightnessTable();
+
+    // normalization, white balance and gamma are a lookup per channel, gamma follows the LUT when it is loaded
+    const unsigned short *table = m_correctionTables.constData();
+    for (int i = 0; i < inColors.count(); i++) {
+        const QRgb color = inColors[i];
+        StructRgb &outColor = outColors[i];
+        outColor.r = table[qRed(color)];
+        outColor.g = table[256 + qGreen(color)];
+        outColor.b = table[512 + qBlue(color)];
+        table += 3 * 256;
+
+        if (isLutApplied) {
+            m_colorLut.map(outColor);
+            PrismatikMath::gammaCorrection(m_gammaTable, outColor);
+            if (!isThresholdApplied)
+                applyBrightnessTable(outColor);
+        }
+    }
+
+    if (!isThresholdApplied)
+        return;
+
+    StructLab avgColor;
+    if (m_isMinimumLuminosityEnabled)
+        avgColor = PrismatikMath::toLab(PrismatikMath::avgColor(outColors));
+
+    for (int i = 0; i < inColors.count(); ++i) {
+        // L* is checked with lookup tables, full Lab is converted only for dimmed LEDs
+        int dl = m_luminosityThreshold - PrismatikMath::lightness(outColors[i]);
         if (dl > 0) {
             if (m_isMinimumLuminosityEnabled) { // apply minimum luminosity or dead-zone
+                StructLab lab = PrismatikMath::toLab(outColors[i]);
                 // Cross-fade a and b channels to avarage value within kFadingRange, fadingFactor = (dL - fadingRange)^2 / (fadingRange^2)
                 const int kFadingRange = 5;
                 double fadingCoeff = dl < kFadingRange ? (dl - kFadingRange)*(dl - kFadingRange)/(kFadingRange*kFadingRange): 1;
@@ -119,7 +230,30 @@ void AbstractLedDevice::applyColorModifications(const QList<QRgb> &inColors, QLi
             }
         }
 
-        PrismatikMath::brightnessCorrection(m_brightness, outColors[i]);
+        applyBrightnessTable(outColors[i]);
     }
+}
 
+void AbstractLedDevice::reduceTo8bit(QVector<StructRgb> &colors) {
+
+    if (!m_isDitheringEnabled) {
+        for (int i = 0; i < colors.count(); ++i) {
+            colors[i].r = colors[i].r >> 4;
+            colors[i].g = colors[i].g >> 4;
+            colors[i].b = colors[i].b >> 4;
+        }
+        return;
+    }
+
+    if (m_ditherResiduals.size() != colors.count() * 3)
+        m_ditherResiduals.fill(0, colors.count() * 3);
+
+    unsigned char *residual = m_ditherResiduals.data();
+    for (int i = 0; i < colors.count(); ++i) {
+        StructRgb &color = colors[i];
+        color.r = PrismatikMath::ditherTo8bit(color.r, residual[0]);
+        color.g = PrismatikMath::ditherTo8bit(color.g, residual[1]);
+        color.b = PrismatikMath::ditherTo8bit(color.b, residual[2]);
+        residual += 3;
+    }
 }
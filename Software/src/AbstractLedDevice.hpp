@@ -29,6 +29,8 @@
 #include <QtGui>
 #include "colorspace_types.h"
 #include "types.h"
+#include "PrismatikMath.hpp"
+#include "ColorLut.hpp"
 
 /*!
     Abstract class representing any LED device.
@@ -38,7 +40,17 @@ class AbstractLedDevice : public QObject
 {
     Q_OBJECT
 public:
-    AbstractLedDevice(QObject * parent) : QObject(parent) {}
+    AbstractLedDevice(QObject * parent)
+        : QObject(parent)
+        , m_isDitheringEnabled(false)
+        , m_frameId(0)
+        , m_gammaTableValue(-1)
+        , m_isCorrectionTablesDirty(true)
+        , m_isGammaInCorrectionTables(false)
+        , m_correctionTablesBrightness(-1)
+        , m_isBrightnessInCorrectionTables(false)
+        , m_brightnessTableValue(-1)
+    {}
     virtual ~AbstractLedDevice(){}
 
 signals:
@@ -59,6 +71,11 @@ public slots:
     virtual void open() = 0;
     virtual void close() = 0;
     virtual void setColors(const QList<QRgb> & colors) = 0;
+
+    /*!
+      setColors() of the grabbed frame, the id is kept in m_frameId while the colors are written
+    */
+    void setFrameColors(const QList<QRgb> & colors, quint64 frameId);
     virtual void switchOffLeds() = 0;
 
     /*!
@@ -87,7 +104,14 @@ public slots:
     virtual void setColorDepth(int value) = 0;
 
 protected:
-    virtual void applyColorModifications(const QList<QRgb> & inColors, QList<StructRgb> & outColors);
+    virtual void applyColorModifications(const QList<QRgb> & inColors, QVector<StructRgb> & outColors);
+
+    /*!
+      Drops 12bit colors to 8bit. With dithering enabled the dropped 4 bits of every channel are
+      added to the next frame of the LED, so the average over frames keeps 12bit precision,
+      see PrismatikMath::ditherTo8bit().
+    */
+    void reduceTo8bit(QVector<StructRgb> & colors);
 
 protected:
     QString m_colorSequence;
@@ -95,9 +119,40 @@ protected:
     int m_brightness;
     int m_luminosityThreshold;
     bool m_isMinimumLuminosityEnabled;
+    bool m_isDitheringEnabled;
 
     QList<WBAdjustment> m_wbAdjustments;
 
     QList<QRgb> m_colorsSaved;
-    QList<StructRgb> m_colorsBuffer;
+    QVector<StructRgb> m_colorsBuffer;
+
+    // frame being written, 0 for colors set not from a grabbed frame, see FrameTracer
+    quint64 m_frameId;
+
+private:
+    void updateCorrectionTables(int ledsCount, bool isGammaIncluded, bool isBrightnessIncluded);
+    void updateBrightnessTable();
+    void applyBrightnessTable(StructRgb &rgb) const;
+
+private:
+    // gamma table is rebuilt when m_gamma differs from the gamma it was built for
+    unsigned short m_gammaTable[PrismatikMath::GammaTableSize];
+    double m_gammaTableValue;
+
+    // 8bit channel value to corrected 12bit value, 3 * 256 entries per LED, see updateCorrectionTables()
+    QVector<unsigned short> m_correctionTables;
+    bool m_isCorrectionTablesDirty;
+    bool m_isGammaInCorrectionTables;
+    int m_correctionTablesBrightness;
+    bool m_isBrightnessInCorrectionTables;
+
+    // brightness applied after luminosity threshold
+    unsigned short m_brightnessTable[PrismatikMath::GammaTableSize];
+    int m_brightnessTableValue;
+
+    // calibration of white balanced colors, applied before gamma when loaded
+    ColorLut m_colorLut;
+
+    // 4bit remainders carried to the next frame, 3 per LED, see reduceTo8bit()
+    QVector<unsigned char> m_ditherResiduals;
 };
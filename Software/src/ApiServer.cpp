@@ -32,6 +32,7 @@
 #include "ApiServerSetColorTask.hpp"
 #include "Settings.hpp"
 #include "TimeEvaluations.hpp"
+#include "PipelineStats.hpp"
 #include "version.h"
 #include <QtWidgets/QApplication>
 
@@ -88,6 +89,10 @@ const char * ApiServer::CmdResultGetColors = "colors:";
 const char * ApiServer::CmdGetFPS = "getfps";
 const char * ApiServer::CmdResultFPS = "fps:";
 
+const char * ApiServer::CmdGetLatency = "getlatency";
+// Necessary to add a new line after filling results!
+const char * ApiServer::CmdResultLatency = "latency:";
+
 const char * ApiServer::CmdGetScreenSize = "getscreensize";
 const char * ApiServer::CmdResultScreenSize = "screensize:";
 
@@ -468,6 +473,21 @@ void ApiServer::clientProcessCommands()
 
             result = QString("%1%2\r\n").arg(CmdResultFPS).arg(lightpack->GetFPS());
         }
+        else if (cmdBuffer == CmdGetLatency)
+        {
+            API_DEBUG_OUT << CmdGetLatency;
+
+            result = CmdResultLatency;
+            for (int i = 0; i < PipelineStage::StagesCount; ++i)
+            {
+                const PipelineStage::Stage stage = static_cast<PipelineStage::Stage>(i);
+                const LatencyHistogram::Summary summary = PipelineStats::summary(stage);
+                result += QString("%1-%2,%3,%4,%5;").arg(PipelineStats::stageName(stage))
+                        .arg(summary.p50Ns / 1000).arg(summary.p95Ns / 1000)
+                        .arg(summary.p99Ns / 1000).arg(summary.maxNs / 1000);
+            }
+            result += "\r\n";
+        }
         else if (cmdBuffer == CmdGetScreenSize)
         {
             API_DEBUG_OUT << CmdGetScreenSize;
@@ -1253,6 +1273,11 @@ void ApiServer::initHelpMessage()
                 "Get FPS grabing",
                 formatHelp(CmdResultFPS + QString("25.57"))
                 );
+    m_helpMessage += formatHelp(
+                CmdGetLatency,
+                "Get latency of grab pipeline stages since start. Format: \"STAGE-P50,P95,P99,MAX;\", microseconds.",
+                formatHelp(CmdResultLatency + QString("capture-850,1200,2100,4800;averaging-120,160,300,900;"))
+                );
     m_helpMessage += formatHelp(
                 CmdGetScreenSize,
                 "Get size screen",
@@ -109,6 +109,9 @@ public:
     static const char * CmdGetFPS;
     static const char * CmdResultFPS;
 
+    static const char * CmdGetLatency;
+    static const char * CmdResultLatency;
+
     static const char * CmdGetScreenSize;
     static const char * CmdResultScreenSize;
 
@@ -0,0 +1,302 @@
+/*
+ * ColorLut.cpp
+ *
+ *     Project: Prismatik
+ *
+ *  Prismatik is a free, open-source software: you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as published
+ *  by the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Prismatik and Lightpack files is distributed in the hope that it will be
+ *  useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "ColorLut.hpp"
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QDateTime>
+#include <QCryptographicHash>
+#include <string.h>
+#include "debug.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   define COLORLUT_SSE2
+#   include <emmintrin.h>
+#endif
+
+namespace {
+const unsigned MaxValue = 4095;
+const int ChannelsPerPoint = 4;
+
+const char CacheMagic[4] = { 'P', 'L', 'U', 'T' };
+const quint32 CacheVersion = 1;
+
+struct CacheHeader {
+    char magic[4];
+    quint32 version;
+    quint32 size;
+    quint32 reserved;
+    qint64 sourceSize;
+    qint64 sourceModifiedMs;
+};
+
+bool isDefaultDomain(const QList<QByteArray> &fields, double expected)
+{
+    if (fields.size() != 4)
+        return false;
+    for (int i = 1; i < 4; ++i) {
+        bool ok = false;
+        if (fields[i].toDouble(&ok) != expected || !ok)
+            return false;
+    }
+    return true;
+}
+}
+
+ColorLut::ColorLut()
+    : m_size(0)
+{
+}
+
+bool ColorLut::load(const QString &cubePath, const QString &cacheDir)
+{
+    DEBUG_LOW_LEVEL << Q_FUNC_INFO << cubePath;
+
+    clear();
+
+    const QFileInfo info(cubePath);
+    if (!info.isFile()) {
+        qWarning() << Q_FUNC_INFO << "no LUT file" << cubePath;
+        return false;
+    }
+    const qint64 sourceSize = info.size();
+    const qint64 sourceModifiedMs = info.lastModified().toMSecsSinceEpoch();
+
+    const QString cachePath = cacheDir.isEmpty() ? QString() : cacheFilePath(cubePath, cacheDir);
+    if (!cachePath.isEmpty() && readCache(cachePath, sourceSize, sourceModifiedMs)) {
+        m_path = cubePath;
+        DEBUG_LOW_LEVEL << Q_FUNC_INFO << "LUT" << m_size << "^3 is read from" << cachePath;
+        return true;
+    }
+
+    if (!parseCube(cubePath)) {
+        clear();
+        return false;
+    }
+    m_path = cubePath;
+    DEBUG_LOW_LEVEL << Q_FUNC_INFO << "LUT" << m_size << "^3 is parsed";
+
+    if (!cachePath.isEmpty())
+        writeCache(cachePath, sourceSize, sourceModifiedMs);
+    return true;
+}
+
+void ColorLut::clear()
+{
+    m_size = 0;
+    m_path.clear();
+    m_lattice.clear();
+}
+
+QString ColorLut::cacheFilePath(const QString &cubePath, const QString &cacheDir)
+{
+    const QByteArray pathHash = QCryptographicHash::hash(QFileInfo(cubePath).absoluteFilePath().toUtf8(), QCryptographicHash::Md5);
+    return QDir(cacheDir).filePath(QString::fromLatin1(pathHash.toHex()) + ".lut");
+}
+
+/*!
+  Tetrahedral interpolation in integers: the cube around the color is split along its diagonal
+  into six tetrahedra and the one containing the color is selected by the order of fractions.
+  The weights of its four corners sum up to 4095.
+*/
+void ColorLut::map(StructRgb &rgb) const
+{
+    if (m_size == 0)
+        return;
+
+    const unsigned maxIndex = m_size - 1;
+    const unsigned value[3] = {
+        qMin(rgb.r, MaxValue),
+        qMin(rgb.g, MaxValue),
+        qMin(rgb.b, MaxValue)
+    };
+    const int stride[3] = {
+        ChannelsPerPoint,
+        ChannelsPerPoint * m_size,
+        ChannelsPerPoint * m_size * m_size
+    };
+
+    int offset = 0;
+    int frac[3];
+    for (int c = 0; c < 3; ++c) {
+        const unsigned scaled = value[c] * maxIndex;
+        unsigned index = scaled / MaxValue;
+        frac[c] = scaled % MaxValue;
+        if (index == maxIndex) {
+            index = maxIndex - 1;
+            frac[c] = MaxValue;
+        }
+        offset += index * stride[c];
+    }
+
+    // axes by descending fraction
+    int a0 = 0, a1 = 1, a2 = 2;
+    if (frac[a0] < frac[a1]) qSwap(a0, a1);
+    if (frac[a1] < frac[a2]) qSwap(a1, a2);
+    if (frac[a0] < frac[a1]) qSwap(a0, a1);
+
+    const quint16 *c0 = m_lattice.constData() + offset;
+    const quint16 *c1 = c0 + stride[a0];
+    const quint16 *c2 = c1 + stride[a1];
+    const quint16 *c3 = c2 + stride[a2];
+    const int w0 = MaxValue - frac[a0];
+    const int w1 = frac[a0] - frac[a1];
+    const int w2 = frac[a1] - frac[a2];
+    const int w3 = frac[a2];
+
+    int sums[4];
+#ifdef COLORLUT_SSE2
+    // corners are interleaved in pairs, so madd gives c0 * w0 + c1 * w1 for each channel at once
+    const __m128i c01 = _mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(c0)),
+                                           _mm_loadl_epi64(reinterpret_cast<const __m128i *>(c1)));
+    const __m128i c23 = _mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(c2)),
+                                           _mm_loadl_epi64(reinterpret_cast<const __m128i *>(c3)));
+    const __m128i sum = _mm_add_epi32(_mm_madd_epi16(c01, _mm_set1_epi32(w0 | (w1 << 16))),
+                                      _mm_madd_epi16(c23, _mm_set1_epi32(w2 | (w3 << 16))));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(sums), sum);
+#else
+    for (int c = 0; c < 3; ++c)
+        sums[c] = c0[c] * w0 + c1[c] * w1 + c2[c] * w2 + c3[c] * w3;
+#endif
+
+    rgb.r = (sums[0] + MaxValue / 2) / MaxValue;
+    rgb.g = (sums[1] + MaxValue / 2) / MaxValue;
+    rgb.b = (sums[2] + MaxValue / 2) / MaxValue;
+}
+
+bool ColorLut::parseCube(const QString &cubePath)
+{
+    QFile file(cubePath);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        qWarning() << Q_FUNC_INFO << "couldn't open" << cubePath << ":" << file.errorString();
+        return false;
+    }
+
+    int size = 0;
+    int pointsCount = 0;
+    int lineNumber = 0;
+    while (!file.atEnd()) {
+        const QByteArray line = file.readLine().simplified();
+        ++lineNumber;
+        if (line.isEmpty() || line.startsWith('#'))
+            continue;
+
+        const QList<QByteArray> fields = line.split(' ');
+        const char first = fields[0][0];
+        if ((first >= 'A' && first <= 'Z') || (first >= 'a' && first <= 'z')) {
+            if (fields[0] == "LUT_3D_SIZE" && fields.size() == 2 && size == 0) {
+                size = fields[1].toInt();
+                if (size < MinSize || size > MaxSize) {
+                    qWarning() << Q_FUNC_INFO << cubePath << "LUT size" << size << "is out of" << MinSize << ".." << MaxSize;
+                    return false;
+                }
+                m_lattice.fill(0, size * size * size * ChannelsPerPoint);
+            } else if ((fields[0] == "DOMAIN_MIN" && !isDefaultDomain(fields, 0.0))
+                       || (fields[0] == "DOMAIN_MAX" && !isDefaultDomain(fields, 1.0))) {
+                qWarning() << Q_FUNC_INFO << cubePath << "only 0..1 domain is supported";
+                return false;
+            } else if (fields[0] == "LUT_1D_SIZE") {
+                qWarning() << Q_FUNC_INFO << cubePath << "1D LUTs are not supported";
+                return false;
+            }
+            // TITLE and other keywords don't change the table
+            continue;
+        }
+
+        if (size == 0 || fields.size() != 3 || pointsCount >= size * size * size) {
+            qWarning() << Q_FUNC_INFO << cubePath << "unexpected line" << lineNumber;
+            return false;
+        }
+
+        quint16 *point = m_lattice.data() + pointsCount * ChannelsPerPoint;
+        for (int c = 0; c < 3; ++c) {
+            bool ok = false;
+            const double value = fields[c].toDouble(&ok);
+            if (!ok) {
+                qWarning() << Q_FUNC_INFO << cubePath << "bad value at line" << lineNumber;
+                return false;
+            }
+            point[c] = static_cast<quint16>(qBound(0.0, value, 1.0) * MaxValue + 0.5);
+        }
+        ++pointsCount;
+    }
+
+    if (size == 0 || pointsCount != size * size * size) {
+        qWarning() << Q_FUNC_INFO << cubePath << "has" << pointsCount << "of" << size * size * size << "LUT points";
+        return false;
+    }
+    m_size = size;
+    return true;
+}
+
+bool ColorLut::readCache(const QString &cachePath, qint64 sourceSize, qint64 sourceModifiedMs)
+{
+    QFile file(cachePath);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    CacheHeader header;
+    if (file.read(reinterpret_cast<char *>(&header), sizeof(header)) != sizeof(header)
+            || memcmp(header.magic, CacheMagic, sizeof(header.magic)) != 0
+            || header.version != CacheVersion
+            || header.sourceSize != sourceSize
+            || header.sourceModifiedMs != sourceModifiedMs
+            || header.size < MinSize || header.size > MaxSize)
+        return false;
+
+    const int size = header.size;
+    const qint64 latticeBytes = static_cast<qint64>(size) * size * size * ChannelsPerPoint * sizeof(quint16);
+    if (file.size() != static_cast<qint64>(sizeof(header)) + latticeBytes)
+        return false;
+
+    m_lattice.resize(size * size * size * ChannelsPerPoint);
+    if (file.read(reinterpret_cast<char *>(m_lattice.data()), latticeBytes) != latticeBytes) {
+        m_lattice.clear();
+        return false;
+    }
+    m_size = size;
+    return true;
+}
+
+void ColorLut::writeCache(const QString &cachePath, qint64 sourceSize, qint64 sourceModifiedMs) const
+{
+    QDir().mkpath(QFileInfo(cachePath).absolutePath());
+
+    QFile file(cachePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << Q_FUNC_INFO << "couldn't open" << cachePath << ":" << file.errorString();
+        return;
+    }
+
+    CacheHeader header;
+    memcpy(header.magic, CacheMagic, sizeof(header.magic));
+    header.version = CacheVersion;
+    header.size = m_size;
+    header.reserved = 0;
+    header.sourceSize = sourceSize;
+    header.sourceModifiedMs = sourceModifiedMs;
+
+    const qint64 latticeBytes = static_cast<qint64>(m_lattice.size()) * sizeof(quint16);
+    // a cache cut short is rejected by its size when it is read
+    if (file.write(reinterpret_cast<const char *>(&header), sizeof(header)) != sizeof(header)
+            || file.write(reinterpret_cast<const char *>(m_lattice.constData()), latticeBytes) != latticeBytes)
+        qWarning() << Q_FUNC_INFO << "couldn't write" << cachePath << ":" << file.errorString();
+}
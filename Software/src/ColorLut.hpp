@@ -0,0 +1,70 @@
+/*
+ * ColorLut.hpp
+ *
+ *     Project: Prismatik
+ *
+ *  Prismatik is a free, open-source software: you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as published
+ *  by the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Prismatik and Lightpack files is distributed in the hope that it will be
+ *  useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <QString>
+#include <QVector>
+#include "colorspace_types.h"
+
+/*!
+  3D color lookup table loaded from an Adobe/Resolve .cube file, maps 12bit RGB to 12bit RGB
+  with tetrahedral interpolation.
+  Parsed tables are cached in a binary file next to other caches, the cache is used while
+  size and modification time of the .cube file are the same.
+*/
+class ColorLut
+{
+public:
+    enum {
+        MinSize = 2,
+        MaxSize = 65
+    };
+
+    ColorLut();
+
+    /*!
+      \param cacheDir directory of binary caches, caching is off when it is empty
+    */
+    bool load(const QString &cubePath, const QString &cacheDir);
+    void clear();
+
+    bool isLoaded() const { return m_size != 0; }
+    int size() const { return m_size; }
+    QString path() const { return m_path; }
+
+    /*!
+      Maps 12bit \a rgb, values above 12bit are clamped
+    */
+    void map(StructRgb &rgb) const;
+
+    static QString cacheFilePath(const QString &cubePath, const QString &cacheDir);
+
+private:
+    bool parseCube(const QString &cubePath);
+    bool readCache(const QString &cachePath, qint64 sourceSize, qint64 sourceModifiedMs);
+    void writeCache(const QString &cachePath, qint64 sourceSize, qint64 sourceModifiedMs) const;
+
+private:
+    int m_size;
+    QString m_path;
+    // 12bit R, G, B and a padding entry per lattice point, red changes fastest
+    QVector<quint16> m_lattice;
+};
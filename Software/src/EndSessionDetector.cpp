@@ -60,10 +60,11 @@ bool EndSessionDetector::nativeEventFilter(const QByteArray& eventType, void* me
 	}
 #endif
 
+	// there is no settings window in headless mode, talk to the device directly
 	if (isSessionEnding)
-		getLightpackApp()->settingsWnd()->switchOffLeds();
+		QMetaObject::invokeMethod(getLightpackApp()->ledDeviceManager(), "switchOffLeds", Qt::QueuedConnection);
 	else if (isSessionResuming)
-		getLightpackApp()->settingsWnd()->switchOnLeds();
+		QMetaObject::invokeMethod(getLightpackApp()->ledDeviceManager(), "switchOnLeds", Qt::QueuedConnection);
 
 	return false;
 }
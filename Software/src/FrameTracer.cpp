@@ -0,0 +1,148 @@
+/*
+ * FrameTracer.cpp
+ *
+ *     Project: Prismatik
+ *
+ *  Prismatik is a free, open-source software: you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as published
+ *  by the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Prismatik and Lightpack files is distributed in the hope that it will be
+ *  useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "FrameTracer.hpp"
+#include <QMutexLocker>
+#include <QThread>
+#include <QCoreApplication>
+#include "debug.h"
+
+namespace {
+const int FlushSize = 64 * 1024;
+}
+
+QAtomicInt FrameTracer::m_isEnabled(0);
+QMutex FrameTracer::m_mutex;
+QFile FrameTracer::m_file;
+QByteArray FrameTracer::m_buffer;
+QElapsedTimer FrameTracer::m_clock;
+QHash<QThread *, int> FrameTracer::m_threadIds;
+
+bool FrameTracer::start(const QString &path)
+{
+    stop();
+
+    QMutexLocker locker(&m_mutex);
+
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << Q_FUNC_INFO << "couldn't open" << path << ":" << m_file.errorString();
+        return false;
+    }
+
+    m_buffer.clear();
+    m_buffer.reserve(FlushSize * 2);
+    // array format, a trace cut short by a crash still opens
+    m_buffer.append("[\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"Prismatik\"}}");
+    m_threadIds.clear();
+    m_clock.start();
+    m_isEnabled.store(1);
+    DEBUG_LOW_LEVEL << Q_FUNC_INFO << "tracing frames to" << path;
+    return true;
+}
+
+void FrameTracer::stop()
+{
+    QMutexLocker locker(&m_mutex);
+
+    if (!m_file.isOpen())
+        return;
+
+    m_isEnabled.store(0);
+    m_buffer.append("\n]\n");
+    flushLocked();
+    m_file.close();
+    DEBUG_LOW_LEVEL << Q_FUNC_INFO << "frames trace is written to" << m_file.fileName();
+}
+
+qint64 FrameTracer::nowNs()
+{
+    return m_clock.nsecsElapsed();
+}
+
+void FrameTracer::complete(const char *name, quint64 frameId, qint64 beginNs, qint64 durationNs, QThread *thread)
+{
+    if (!isEnabled())
+        return;
+
+    QMutexLocker locker(&m_mutex);
+    if (!m_file.isOpen())
+        return;
+
+    // timestamps are microseconds
+    m_buffer.append(QString(",\n{\"name\":\"%1\",\"cat\":\"frame\",\"ph\":\"X\",\"ts\":%2,\"dur\":%3,\"pid\":1,\"tid\":%4,\"args\":{\"frame\":%5}}")
+                    .arg(name)
+                    .arg(beginNs / 1000.0, 0, 'f', 3)
+                    .arg(qMax(Q_INT64_C(0), durationNs) / 1000.0, 0, 'f', 3)
+                    .arg(threadIdLocked(thread ? thread : QThread::currentThread()))
+                    .arg(frameId).toLatin1());
+    if (m_buffer.size() >= FlushSize)
+        flushLocked();
+}
+
+void FrameTracer::instant(const char *name, quint64 frameId)
+{
+    if (!isEnabled())
+        return;
+
+    QMutexLocker locker(&m_mutex);
+    if (!m_file.isOpen())
+        return;
+
+    m_buffer.append(QString(",\n{\"name\":\"%1\",\"cat\":\"frame\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%2,\"pid\":1,\"tid\":%3,\"args\":{\"frame\":%4}}")
+                    .arg(name)
+                    .arg(nowNs() / 1000.0, 0, 'f', 3)
+                    .arg(threadIdLocked(QThread::currentThread()))
+                    .arg(frameId).toLatin1());
+    if (m_buffer.size() >= FlushSize)
+        flushLocked();
+}
+
+/*!
+  Small stable ids for threads, names are written once as metadata events
+*/
+int FrameTracer::threadIdLocked(QThread *thread)
+{
+    QHash<QThread *, int>::const_iterator it = m_threadIds.constFind(thread);
+    if (it != m_threadIds.constEnd())
+        return it.value();
+
+    const int threadId = m_threadIds.size() + 1;
+    m_threadIds.insert(thread, threadId);
+
+    QString threadName = thread->objectName();
+    if (threadName.isEmpty())
+        threadName = (QCoreApplication::instance() && thread == QCoreApplication::instance()->thread())
+                ? QString("MainThread") : QString("Thread%1").arg(threadId);
+    m_buffer.append(QString(",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%1,\"args\":{\"name\":\"%2\"}}")
+                    .arg(threadId)
+                    .arg(threadName).toLatin1());
+    return threadId;
+}
+
+void FrameTracer::flushLocked()
+{
+    if (m_file.write(m_buffer) != m_buffer.size()) {
+        qWarning() << Q_FUNC_INFO << "couldn't write" << m_file.fileName() << ":" << m_file.errorString() << ", tracing is stopped";
+        m_isEnabled.store(0);
+        m_file.close();
+    }
+    m_buffer.clear();
+}
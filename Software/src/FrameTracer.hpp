@@ -0,0 +1,89 @@
+/*
+ * FrameTracer.hpp
+ *
+ *     Project: Prismatik
+ *
+ *  Prismatik is a free, open-source software: you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as published
+ *  by the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Prismatik and Lightpack files is distributed in the hope that it will be
+ *  useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <QtGlobal>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+
+class QThread;
+
+/*!
+  Writes spans of every frame passing the grab pipeline to a trace event JSON file, which opens
+  in chrome://tracing or Perfetto. Spans carry the frame id, so skipped ids, coalesced and late
+  frames are visible. Tracing is off unless started, then every span costs a single atomic load.
+*/
+class FrameTracer
+{
+public:
+    static bool start(const QString &path);
+    static void stop();
+    static bool isEnabled() { return m_isEnabled.load() != 0; }
+
+    /*!
+      Tracer clock time, spans measured with other clocks are converted to it by age
+    */
+    static qint64 nowNs();
+
+    /*!
+      \param name is copied to the trace as is, it must not need JSON escaping
+      \param thread the span is shown on, NULL is the current thread
+    */
+    static void complete(const char *name, quint64 frameId, qint64 beginNs, qint64 durationNs, QThread *thread = NULL);
+    static void instant(const char *name, quint64 frameId);
+
+private:
+    static int threadIdLocked(QThread *thread);
+    static void flushLocked();
+
+private:
+    static QAtomicInt m_isEnabled;
+    static QMutex m_mutex;
+    static QFile m_file;
+    static QByteArray m_buffer;
+    static QElapsedTimer m_clock;
+    static QHash<QThread *, int> m_threadIds;
+};
+
+/*!
+  Span of the enclosing scope on the current thread, \a name is kept until the scope ends
+*/
+class FrameTraceScope
+{
+public:
+    FrameTraceScope(const char *name, quint64 frameId)
+        : m_name(name)
+        , m_frameId(frameId)
+        , m_beginNs(FrameTracer::isEnabled() ? FrameTracer::nowNs() : -1)
+    {}
+    ~FrameTraceScope() {
+        if (m_beginNs >= 0 && FrameTracer::isEnabled())
+            FrameTracer::complete(m_name, m_frameId, m_beginNs, FrameTracer::nowNs() - m_beginNs);
+    }
+
+private:
+    const char *m_name;
+    quint64 m_frameId;
+    qint64 m_beginNs;
+};
@@ -32,12 +32,23 @@
 #include <QtWidgets/QApplication>
 #include <QtWidgets/QDesktopWidget>
 #include "GrabberContext.hpp"
+#include "TimeredGrabber.hpp"
+#include "PipelineStats.hpp"
+#include "FrameTracer.hpp"
 using namespace SettingsScope;
 
 #if defined _MSC_VER
 using PrismatikMath::round;
 #endif
 
+namespace {
+// Largest change of a color channel between frames, zone colors are 0..255 per channel
+const int MotionHighThreshold = 6;  // switch to the full grab rate right away
+const int MotionLowThreshold = 2;   // picture is considered static
+// Static frames in a row before the grab interval is increased once more
+const int StaticFramesToSlowDown = 15;
+}
+
 #ifdef D3D10_GRAB_SUPPORT
 void *GetMainWindowHandle()
 {
@@ -57,12 +68,23 @@ GrabManager::GrabManager(QWidget *parent) : QObject(parent)
     m_timeEval = new TimeEvaluations();
 
     m_fpsMs = 0;
+    m_colorsFrameId = 0;
 
     m_grabberContext = new GrabberContext();
 
     m_isSendDataOnlyIfColorsChanged = Settings::isSendDataOnlyIfColorsChanges();
 
-//    m_grabbersThread = new QThread();
+    m_isAdaptiveRateEnabled = Settings::isGrabAdaptiveRateEnabled();
+    m_grabTargetFps = Settings::getGrabTargetFps();
+    m_grabSlowdownMs = baseSlowdownMs();
+    m_adaptiveSlowdownMaxMs = Settings::getGrabAdaptiveSlowdownMax();
+    m_currentSlowdownMs = m_grabSlowdownMs;
+    m_staticFramesCount = 0;
+
+    // grabbers live on their own thread, results are handed over through GrabberContext#grabResult
+    m_grabbersThread = new QThread();
+    m_grabbersThread->setObjectName("GrabbersThread");
+    m_grabbersThread->start();
     initGrabbers();
     m_grabber = queryGrabber(Settings::getGrabberType());
 
@@ -73,9 +95,9 @@ GrabManager::GrabManager(QWidget *parent) : QObject(parent)
 
     m_isPauseGrabWhileResizeOrMoving = false;
     m_isGrabWidgetsVisible = false;
+    m_isGrabWidgetsColored = true;
 
     initColorLists(MaximumNumberOfLeds::Default);
-    initLedWidgets(MaximumNumberOfLeds::Default);
 
 //    connect(m_timerGrab, SIGNAL(timeout()), this, SLOT(handleGrabbedColors()));
     connect(QApplication::desktop(), SIGNAL(resized(int)), this, SLOT(scaleLedWidgets(int)));
@@ -97,22 +119,24 @@ GrabManager::~GrabManager()
     delete m_timeEval;
     m_grabber = NULL;
 
-    for (int i = 0; i < m_ledWidgets.size(); i++)
-    {
-        delete m_ledWidgets[i];
-    }
-
+    qDeleteAll(m_ledWidgets);
     m_ledWidgets.clear();
 
+    // grabbers are deleted on their own thread, pending deletions are processed when it finishes
     for (int i = 0; i < m_grabbers.size(); i++)
         if (m_grabbers[i]){
             DEBUG_OUT << "deleting " << m_grabbers[i]->name();
-            delete m_grabbers[i];
+            m_grabbers[i]->deleteLater();
             m_grabbers[i] = NULL;
         }
 
     m_grabbers.clear();
 
+    m_grabbersThread->quit();
+    m_grabbersThread->wait();
+    delete m_grabbersThread;
+    m_grabbersThread = NULL;
+
 #ifdef D3D10_GRAB_SUPPORT
     delete m_d3d10Grabber;
     m_d3d10Grabber = NULL;
@@ -129,12 +153,13 @@ void GrabManager::start(bool isGrabEnabled)
 
     if (m_grabber != NULL) {
         if (isGrabEnabled) {
+            updateGrabZones();
             m_timerUpdateFPS->start();
-            m_grabber->startGrabbing();
+            startGrabber(m_grabber);
         } else {
             clearColorsCurrent();
             m_timerUpdateFPS->stop();
-            m_grabber->stopGrabbing();
+            stopGrabber(m_grabber);
             emit ambilightTimeOfUpdatingColors(0);
         }
     }
@@ -146,11 +171,11 @@ void GrabManager::onGrabberTypeChanged(const Grab::GrabberType grabberType)
 
     bool isStartNeeded = false;
     if (m_grabber != NULL) {
-        isStartNeeded = m_grabber->isGrabbingStarted();
+        isStartNeeded = isGrabberStarted(m_grabber);
 #ifdef D3D10_GRAB_SUPPORT
         isStartNeeded = isStartNeeded || (m_d3d10Grabber != NULL && m_d3d10Grabber->isGrabbingStarted());
 #endif
-        m_grabber->stopGrabbing();
+        stopGrabber(m_grabber);
     }
 
     m_grabber = queryGrabber(grabberType);
@@ -160,9 +185,9 @@ void GrabManager::onGrabberTypeChanged(const Grab::GrabberType grabberType)
         if (Settings::isDx1011GrabberEnabled())
             m_d3d10Grabber->startGrabbing();
         else
-            m_grabber->startGrabbing();
+            startGrabber(m_grabber);
 #else
-        m_grabber->startGrabbing();
+        startGrabber(m_grabber);
 #endif
     }
 }
@@ -173,11 +198,11 @@ void GrabManager::onGrabberStateChangeRequested(bool isStartRequested) {
     if (grabber != m_grabber) {
         if (isStartRequested) {
             if (Settings::isDx1011GrabberEnabled()) {
-                m_grabber->stopGrabbing();
+                stopGrabber(m_grabber);
                 grabber->startGrabbing();
             }
         } else {
-            m_grabber->startGrabbing();
+            startGrabber(m_grabber);
             grabber->stopGrabbing();
         }
     } else {
@@ -191,12 +216,47 @@ void GrabManager::onGrabberStateChangeRequested(bool isStartRequested) {
 void GrabManager::onGrabSlowdownChanged(int ms)
 {
     DEBUG_LOW_LEVEL << Q_FUNC_INFO << ms;
+    m_grabSlowdownMs = m_grabTargetFps > 0 ? baseSlowdownMs() : ms;
+    m_staticFramesCount = 0;
     if (m_grabber)
-        m_grabber->setGrabInterval(ms);
+        setCurrentSlowdown(m_grabSlowdownMs);
     else
         qWarning() << Q_FUNC_INFO << "trying to change grab slowdown while there is no grabber";
 }
 
+void GrabManager::onGrabTargetFpsChanged(double fps)
+{
+    DEBUG_LOW_LEVEL << Q_FUNC_INFO << fps;
+    m_grabTargetFps = fps;
+    m_grabSlowdownMs = baseSlowdownMs();
+    m_staticFramesCount = 0;
+    if (m_grabber)
+        setCurrentSlowdown(m_grabSlowdownMs);
+}
+
+void GrabManager::onGrabAdaptiveRateEnabledChanged(bool isEnabled)
+{
+    DEBUG_LOW_LEVEL << Q_FUNC_INFO << isEnabled;
+    m_isAdaptiveRateEnabled = isEnabled;
+    m_staticFramesCount = 0;
+    if (!isEnabled && m_grabber)
+        setCurrentSlowdown(m_grabSlowdownMs);
+}
+
+void GrabManager::onGrabAdaptiveSlowdownMaxChanged(int ms)
+{
+    DEBUG_LOW_LEVEL << Q_FUNC_INFO << ms;
+    m_adaptiveSlowdownMaxMs = ms;
+    if (m_currentSlowdownMs > qMax(ms, m_grabSlowdownMs) && m_grabber)
+        setCurrentSlowdown(qMax(ms, m_grabSlowdownMs));
+}
+
+void GrabManager::onGrabSubsamplingStepChanged(int step)
+{
+    DEBUG_LOW_LEVEL << Q_FUNC_INFO << step;
+    m_grabberContext->subsamplingStep.store(step);
+}
+
 void GrabManager::onGrabAvgColorsEnabledChanged(bool state)
 {
     DEBUG_LOW_LEVEL << Q_FUNC_INFO << state;
@@ -214,13 +274,15 @@ void GrabManager::setNumberOfLeds(int numberOfLeds)
     DEBUG_LOW_LEVEL << Q_FUNC_INFO << numberOfLeds;
 
     initColorLists(numberOfLeds);
-    initLedWidgets(numberOfLeds);
+    loadGrabZones(numberOfLeds);
 
-    for (int i = 0; i < m_ledWidgets.size(); i++)
+    if (m_isGrabWidgetsVisible)
     {
-        m_ledWidgets[i]->settingsProfileChanged();
-        m_ledWidgets[i]->setVisible(m_isGrabWidgetsVisible);
+        destroyLedWidgets();
+        createLedWidgets();
     }
+
+    updateGrabZones();
 }
 
 void GrabManager::reset()
@@ -228,6 +290,61 @@ void GrabManager::reset()
     clearColorsCurrent();
 }
 
+bool GrabManager::startFrameRecording(const QString &path)
+{
+    DEBUG_LOW_LEVEL << Q_FUNC_INFO << path;
+    return m_grabberContext->frameRecorder.start(path);
+}
+
+void GrabManager::stopFrameRecording()
+{
+    DEBUG_LOW_LEVEL << Q_FUNC_INFO;
+    m_grabberContext->frameRecorder.stop();
+}
+
+void GrabManager::replayFrames(const QString &path, bool isRealtime)
+{
+    DEBUG_LOW_LEVEL << Q_FUNC_INFO << path << isRealtime;
+
+    GrabberBase *replayGrabber = m_grabbers[Grab::GrabberTypeReplay];
+    QMetaObject::invokeMethod(replayGrabber, "setRealtime", Q_ARG(bool, isRealtime));
+    QMetaObject::invokeMethod(replayGrabber, "openRecording", Q_ARG(QString, path));
+    switchGrabber(replayGrabber);
+}
+
+void GrabManager::grabFrameSource(const QString &source)
+{
+    DEBUG_LOW_LEVEL << Q_FUNC_INFO << source;
+
+    GrabberBase *frameSourceGrabber = m_grabbers[Grab::GrabberTypeFrameSource];
+    if (frameSourceGrabber == NULL) {
+        qWarning() << Q_FUNC_INFO << "frame sources are not supported on the platform";
+        return;
+    }
+
+    // frame covers the primary screen, zones are laid out on it
+    const QPoint origin = QApplication::desktop()->screenGeometry(QApplication::desktop()->primaryScreen()).topLeft();
+    QMetaObject::invokeMethod(frameSourceGrabber, "setOrigin", Q_ARG(QPoint, origin));
+    QMetaObject::invokeMethod(frameSourceGrabber, "openSource", Q_ARG(QString, source));
+    switchGrabber(frameSourceGrabber);
+}
+
+void GrabManager::switchGrabber(GrabberBase *grabber)
+{
+    if (m_grabber == grabber)
+        return;
+
+    bool isStartNeeded = false;
+    if (m_grabber != NULL) {
+        isStartNeeded = isGrabberStarted(m_grabber);
+        stopGrabber(m_grabber);
+    }
+    m_grabber = grabber;
+    setGrabberInterval(m_grabber, m_currentSlowdownMs);
+    if (isStartNeeded)
+        startGrabber(m_grabber);
+}
+
 void GrabManager::settingsProfileChanged(const QString &profileName)
 {
     DEBUG_LOW_LEVEL << Q_FUNC_INFO;
@@ -235,6 +352,12 @@ void GrabManager::settingsProfileChanged(const QString &profileName)
 
     m_isSendDataOnlyIfColorsChanged = Settings::isSendDataOnlyIfColorsChanges();
     m_avgColorsOnAllLeds = Settings::isGrabAvgColorsEnabled();
+    m_grabberContext->subsamplingStep.store(Settings::getGrabSubsamplingStep());
+    m_isAdaptiveRateEnabled = Settings::isGrabAdaptiveRateEnabled();
+    m_adaptiveSlowdownMaxMs = Settings::getGrabAdaptiveSlowdownMax();
+    // target fps has no UI to be reapplied from like Slowdown
+    if (m_grabTargetFps != Settings::getGrabTargetFps())
+        onGrabTargetFpsChanged(Settings::getGrabTargetFps());
 
     setNumberOfLeds(Settings::getNumberOfLeds(Settings::getConnectedDevice()));
 }
@@ -243,17 +366,16 @@ void GrabManager::setVisibleLedWidgets(bool state)
 {
     DEBUG_LOW_LEVEL << Q_FUNC_INFO << state;
 
+    if (m_isGrabWidgetsVisible == state)
+        return;
+
     m_isGrabWidgetsVisible = state;
 
-    for (int i = 0; i < m_ledWidgets.size(); i++)
-    {
-        if (state)
-        {
-            m_ledWidgets[i]->show();
-        } else {
-            m_ledWidgets[i]->hide();
-        }
-    }
+    // widgets save their geometry to settings on every change, nothing is lost with them
+    if (state)
+        createLedWidgets();
+    else
+        destroyLedWidgets();
 }
 
 void GrabManager::setColoredLedWidgets(bool state)
@@ -263,6 +385,7 @@ void GrabManager::setColoredLedWidgets(bool state)
     // This slot is directly connected to radioButton toggled(bool) signal
     if (state)
     {
+        m_isGrabWidgetsColored = true;
         for (int i = 0; i < m_ledWidgets.size(); i++)
             m_ledWidgets[i]->fillBackgroundColored();
     }
@@ -275,6 +398,7 @@ void GrabManager::setWhiteLedWidgets(bool state)
     // This slot is directly connected to radioButton toggled(bool) signal
     if (state)
     {
+        m_isGrabWidgetsColored = false;
         for (int i = 0; i < m_ledWidgets.size(); i++)
             m_ledWidgets[i]->fillBackgroundWhite();
     }
@@ -305,9 +429,9 @@ void GrabManager::handleGrabbedColors()
 
     if (m_avgColorsOnAllLeds)
     {
-        for (int i = 0; i < m_ledWidgets.size(); i++)
+        for (int i = 0; i < m_grabZones.size(); i++)
         {
-            if (m_ledWidgets[i]->isAreaEnabled())
+            if (m_grabZones[i].isAreaEnabled)
             {
                     avgR += qRed(m_colorsNew[i]);
                     avgG += qGreen(m_colorsNew[i]);
@@ -322,9 +446,9 @@ void GrabManager::handleGrabbedColors()
             avgB /= countGrabEnabled;
         }
         // Set one AVG color to all LEDs
-        for (int ledIndex = 0; ledIndex < m_ledWidgets.size(); ledIndex++)
+        for (int ledIndex = 0; ledIndex < m_grabZones.size(); ledIndex++)
         {
-            if (m_ledWidgets[ledIndex]->isAreaEnabled())
+            if (m_grabZones[ledIndex].isAreaEnabled)
             {
                 m_colorsNew[ledIndex] = qRgb(avgR, avgG, avgB);
             }
@@ -347,7 +471,7 @@ void GrabManager::handleGrabbedColors()
 //        m_colorsNew[i] = qRgb(r, g, b);
 //    }
 
-    for (int i = 0; i < m_ledWidgets.size(); i++)
+    for (int i = 0; i < m_grabZones.size(); i++)
     {
         if (m_colorsCurrent[i] != m_colorsNew[i])
         {
@@ -358,7 +482,9 @@ void GrabManager::handleGrabbedColors()
 
     if ((m_isSendDataOnlyIfColorsChanged == false) || isColorsChanged)
     {
-        emit updateLedsColors(m_colorsCurrent);
+        emit updateLedsColors(m_colorsCurrent, m_colorsFrameId);
+    } else {
+        FrameTracer::instant("unchanged colors", m_colorsFrameId);
     }
 
     m_fpsMs = m_timeEval->howLongItEnd();
@@ -368,10 +494,24 @@ void GrabManager::handleGrabbedColors()
 
 void GrabManager::timeoutUpdateFPS()
 {
-    DEBUG_MID_LEVEL << Q_FUNC_INFO;
+    DEBUG_MID_LEVEL << Q_FUNC_INFO << "skipped frames:" << skippedFramesCount() << "missed deadlines:" << missedDeadlinesCount();
+    DEBUG_MID_LEVEL << Q_FUNC_INFO << "pipeline:" << PipelineStats::summaryText();
+    DEBUG_MID_LEVEL << Q_FUNC_INFO << "frame buffers, KiB allocated:" << m_grabberContext->bufferArena.allocatedBytes() / 1024
+                    << "peak:" << m_grabberContext->bufferArena.peakAllocatedBytes() / 1024;
     emit ambilightTimeOfUpdatingColors(m_fpsMs);
 }
 
+quint32 GrabManager::skippedFramesCount() const
+{
+    return m_grabber ? m_grabber->skippedFramesCount() : 0;
+}
+
+quint32 GrabManager::missedDeadlinesCount() const
+{
+    const TimeredGrabber *grabber = qobject_cast<const TimeredGrabber *>(m_grabber);
+    return grabber ? grabber->missedDeadlinesCount() : 0;
+}
+
 void GrabManager::pauseWhileResizeOrMoving()
 {
     DEBUG_MID_LEVEL << Q_FUNC_INFO;
@@ -427,16 +567,18 @@ void GrabManager::scaleLedWidgets(int screenIndexResized)
 
     m_lastScreenGeometry[screenIndexResized] = screenGeometry;
 
-    for(int i=0; i < m_ledWidgets.size(); i++){
+    for(int i=0; i < m_grabZones.size(); i++){
 
-        if (!lastScreenGeometry.contains(m_ledWidgets[i]->geometry().center()))
+        const QRect geometry(Settings::getLedPosition(i), Settings::getLedSize(i));
+
+        if (!lastScreenGeometry.contains(geometry.center()))
             continue;
 
-        int width  = round(scaleX * m_ledWidgets[i]->width());
-        int height = round(scaleY * m_ledWidgets[i]->height());
+        int width  = round(scaleX * geometry.width());
+        int height = round(scaleY * geometry.height());
 
-        int x = m_ledWidgets[i]->x();
-        int y = m_ledWidgets[i]->y();
+        int x = geometry.x();
+        int y = geometry.y();
 
         x -= screenGeometry.x();
         y -= screenGeometry.y();
@@ -450,23 +592,27 @@ void GrabManager::scaleLedWidgets(int screenIndexResized)
         x -= deltaX;
         y -= deltaY;
 
-        m_ledWidgets[i]->move(x,y);
-        m_ledWidgets[i]->resize(width, height);
+        Settings::setLedPosition(i, QPoint(x, y));
+        Settings::setLedSize(i, QSize(width, height));
 
-        m_ledWidgets[i]->saveSizeAndPosition();
+        if (i < m_ledWidgets.size())
+        {
+            m_ledWidgets[i]->move(x,y);
+            m_ledWidgets[i]->resize(width, height);
+        }
 
         DEBUG_LOW_LEVEL << Q_FUNC_INFO << "new values [" << i << "]" << "x =" << x << "y =" << y << "w =" << width << "h =" << height;
     }
 
+    loadGrabZones(m_grabZones.size());
+    updateGrabZones();
+
 }
 
 void GrabManager::initGrabbers()
 {
     DEBUG_LOW_LEVEL << Q_FUNC_INFO;
 
-    m_grabberContext->grabWidgets = &m_ledWidgets;
-    m_grabberContext->grabResult = &m_colorsNew;
-
     for (int i = 0; i < Grab::GrabbersCount; i++)
         m_grabbers.append(NULL);
 
@@ -482,6 +628,10 @@ void GrabManager::initGrabbers()
     m_grabbers[Grab::GrabberTypeX11] = initGrabber(new X11Grabber(NULL, m_grabberContext));
 #endif
 
+#ifdef XCB_SHM_GRAB_SUPPORT
+    m_grabbers[Grab::GrabberTypeXcbShm] = initGrabber(new XcbShmGrabber(NULL, m_grabberContext));
+#endif
+
 #ifdef MAC_OS_CG_GRAB_SUPPORT
     m_grabbers[Grab::GrabberTypeMacCoreGraphics] = initGrabber(new MacOSGrabber(NULL, m_grabberContext));
 #endif
@@ -489,6 +639,10 @@ void GrabManager::initGrabbers()
     //TODO: migrate Qt grabbers to the new hierarchy
     m_grabbers[Grab::GrabberTypeQtEachWidget] = initGrabber(new QtGrabberEachWidget(NULL, m_grabberContext));
     m_grabbers[Grab::GrabberTypeQt] = initGrabber(new QtGrabber(NULL, m_grabberContext));
+#endif
+    m_grabbers[Grab::GrabberTypeReplay] = initGrabber(new ReplayGrabber(NULL, m_grabberContext));
+#ifdef FRAME_SOURCE_GRAB_SUPPORT
+    m_grabbers[Grab::GrabberTypeFrameSource] = initGrabber(new FrameSourceGrabber(NULL, m_grabberContext));
 #endif
 #ifdef WINAPI_EACH_GRAB_SUPPORT
     m_grabbers[Grab::GrabberTypeWinAPIEachWidget] = initGrabber(new WinAPIGrabberEachWidget(NULL, m_grabberContext));
@@ -498,10 +652,15 @@ void GrabManager::initGrabbers()
     connect(m_d3d10Grabber, SIGNAL(grabberStateChangeRequested(bool)), SLOT(onGrabberStateChangeRequested(bool)));
     connect(getLightpackApp(), SIGNAL(postInitialization()), m_d3d10Grabber,  SLOT(init()));
 #endif
+
+    // D3D10Grabber stays on the GUI thread, it needs the main window and runs its own worker
+    for (int i = 0; i < m_grabbers.size(); ++i)
+        if (m_grabbers[i])
+            m_grabbers[i]->moveToThread(m_grabbersThread);
 }
 
 GrabberBase *GrabManager::initGrabber(GrabberBase * grabber) {
-    QMetaObject::invokeMethod(grabber, "setGrabInterval", Qt::QueuedConnection, Q_ARG(int, Settings::getGrabSlowdown()));
+    setGrabberInterval(grabber, m_grabSlowdownMs, Qt::QueuedConnection);
 //    QMetaObject::invokeMethod(grabber, "startGrabbing", Qt::QueuedConnection);
     bool isConnected = connect(grabber, SIGNAL(frameGrabAttempted(GrabResult)), this, SLOT(onFrameGrabAttempted(GrabResult)), Qt::QueuedConnection);
     Q_ASSERT_X(isConnected, "connecting grabber to grabManager", "failed");
@@ -521,15 +680,163 @@ GrabberBase *GrabManager::queryGrabber(Grab::GrabberType grabberType)
         result = m_grabbers[Grab::GrabberTypeQt];
     }
 
-    result->setGrabInterval(Settings::getGrabSlowdown());
+    m_grabSlowdownMs = baseSlowdownMs();
+    m_currentSlowdownMs = m_grabSlowdownMs;
+    m_staticFramesCount = 0;
+    setGrabberInterval(result, m_currentSlowdownMs);
 
     return result;
 }
 
+void GrabManager::startGrabber(GrabberBase *grabber)
+{
+    QMetaObject::invokeMethod(grabber, "startGrabbing");
+}
+
+void GrabManager::stopGrabber(GrabberBase *grabber)
+{
+    QMetaObject::invokeMethod(grabber, "stopGrabbing");
+}
+
+bool GrabManager::isGrabberStarted(GrabberBase *grabber) const
+{
+    bool isStarted = false;
+    Qt::ConnectionType connectionType = grabber->thread() == QThread::currentThread() ? Qt::DirectConnection : Qt::BlockingQueuedConnection;
+    QMetaObject::invokeMethod(grabber, "isGrabbingStarted", connectionType, Q_RETURN_ARG(bool, isStarted));
+    return isStarted;
+}
+
+/*!
+  Largest change of a zone color channel since the previous grabbed frame
+*/
+int GrabManager::motionOfFrame(const QList<QRgb> &colors)
+{
+    int motion = 0;
+    if (m_colorsLastGrabbed.size() != colors.size()) {
+        m_colorsLastGrabbed = colors;
+        return motion;
+    }
+    for (int i = 0; i < colors.size(); ++i) {
+        const QRgb last = m_colorsLastGrabbed[i];
+        const QRgb color = colors[i];
+        motion = qMax(motion, qAbs(qRed(color) - qRed(last)));
+        motion = qMax(motion, qAbs(qGreen(color) - qGreen(last)));
+        motion = qMax(motion, qAbs(qBlue(color) - qBlue(last)));
+        m_colorsLastGrabbed[i] = color;
+    }
+    return motion;
+}
+
+/*!
+  Jumps to the full grab rate on motion and slows down step by step while the picture is static.
+  Changes in between the thresholds keep the current rate.
+*/
+void GrabManager::updateAdaptiveRate(int motion)
+{
+    if (motion >= MotionHighThreshold) {
+        m_staticFramesCount = 0;
+        if (m_currentSlowdownMs != m_grabSlowdownMs)
+            setCurrentSlowdown(m_grabSlowdownMs);
+        return;
+    }
+
+    if (motion > MotionLowThreshold) {
+        m_staticFramesCount = 0;
+        return;
+    }
+
+    if (++m_staticFramesCount < StaticFramesToSlowDown)
+        return;
+    m_staticFramesCount = 0;
+
+    const int slowdownMax = qMax(m_adaptiveSlowdownMaxMs, m_grabSlowdownMs);
+    const int slowdown = qMin(slowdownMax, m_currentSlowdownMs + m_currentSlowdownMs / 2 + 1);
+    if (slowdown != m_currentSlowdownMs)
+        setCurrentSlowdown(slowdown);
+}
+
+void GrabManager::setCurrentSlowdown(int ms)
+{
+    DEBUG_MID_LEVEL << Q_FUNC_INFO << ms;
+    m_currentSlowdownMs = ms;
+    setGrabberInterval(m_grabber, ms);
+}
+
+/*!
+  Target fps is set instead of the base interval, adaptive rate slows down from it in whole milliseconds.
+  Only TimeredGrabber takes fractional rates, others get the rounded interval.
+*/
+void GrabManager::setGrabberInterval(GrabberBase *grabber, int ms, Qt::ConnectionType type)
+{
+    if (m_grabTargetFps > 0 && ms == m_grabSlowdownMs && qobject_cast<TimeredGrabber *>(grabber) != NULL)
+        QMetaObject::invokeMethod(grabber, "setGrabFps", type, Q_ARG(double, m_grabTargetFps));
+    else
+        QMetaObject::invokeMethod(grabber, "setGrabInterval", type, Q_ARG(int, ms));
+}
+
+int GrabManager::baseSlowdownMs() const
+{
+    if (m_grabTargetFps > 0)
+        return qBound(Profile::Grab::SlowdownMin, qRound(1000 / m_grabTargetFps), Profile::Grab::SlowdownMax);
+    return Settings::getGrabSlowdown();
+}
+
+/*!
+  Refreshes zones edited with widgets and hands all zones over to grabbers
+*/
+void GrabManager::updateGrabZones()
+{
+    for (int i = 0; i < m_ledWidgets.size() && i < m_grabZones.size(); ++i) {
+        m_grabZones[i].rect = GrabberBase::grabRectOfWidget(m_ledWidgets[i]);
+        m_grabZones[i].isAreaEnabled = m_ledWidgets[i]->isAreaEnabled();
+    }
+    m_grabberContext->setGrabZones(m_grabZones);
+}
+
 void GrabManager::onFrameGrabAttempted(GrabResult grabResult) {
-    if (grabResult == GrabResultOk) {
+    QElapsedTimer stageTimer;
+    stageTimer.start();
+
+    // only the latest frame is kept in the slot, grabbers never wait for the GUI thread
+    const bool isFrameConsumed = m_grabberContext->grabResult.consume();
+    int motion = 0;
+    if (isFrameConsumed) {
+        const GrabbedFrame &frame = m_grabberContext->grabResult.readBuffer();
+        const QList<QRgb> &colors = frame.colors;
+        // frame grabbed before the number of LEDs changed is dropped
+        if (colors.size() == m_colorsNew.size()) {
+            m_colorsFrameId = frame.frameId;
+            motion = motionOfFrame(colors);
+            for (int i = 0; i < colors.size(); ++i)
+                m_colorsNew[i] = colors[i];
+        }
+    }
+
+    if (m_isAdaptiveRateEnabled && (grabResult == GrabResultOk || grabResult == GrabResultFrameUnchanged))
+        updateAdaptiveRate(motion);
+
+    // unchanged frame keeps previous colors, they are still sent if data is sent unconditionally
+    if (grabResult == GrabResultOk || grabResult == GrabResultFrameUnchanged) {
         handleGrabbedColors();
     }
+
+    if (isFrameConsumed) {
+        const GrabbedFrame &frame = m_grabberContext->grabResult.readBuffer();
+        const qint64 processingNs = stageTimer.nsecsElapsed();
+        const qint64 queueDelayNs = m_grabberContext->clock.nsecsElapsed() - frame.publishedNs - processingNs;
+        PipelineStats::record(PipelineStage::Capture, frame.captureNs);
+        PipelineStats::record(PipelineStage::Averaging, frame.computeNs);
+        PipelineStats::record(PipelineStage::Handover, queueDelayNs);
+        PipelineStats::record(PipelineStage::PostProcessing, processingNs);
+
+        if (FrameTracer::isEnabled()) {
+            // grabbers thread spans are measured with the context clock, convert them by age
+            const qint64 publishedTraceNs = FrameTracer::nowNs() - (m_grabberContext->clock.nsecsElapsed() - frame.publishedNs);
+            FrameTracer::complete("capture", frame.frameId, publishedTraceNs - frame.computeNs - frame.captureNs, frame.captureNs, m_grabbersThread);
+            FrameTracer::complete("averaging", frame.frameId, publishedTraceNs - frame.computeNs, frame.computeNs, m_grabbersThread);
+            FrameTracer::complete("postprocessing", frame.frameId, FrameTracer::nowNs() - processingNs, processingNs);
+        }
+    }
 }
 
 void GrabManager::initColorLists(int numberOfLeds)
@@ -566,54 +873,55 @@ void GrabManager::clearColorsCurrent()
     }
 }
 
-void GrabManager::initLedWidgets(int numberOfLeds)
+void GrabManager::loadGrabZones(int numberOfLeds)
 {
     DEBUG_LOW_LEVEL << Q_FUNC_INFO << numberOfLeds;
 
-    if (m_ledWidgets.size() == 0)
+    m_grabZones.clear();
+    m_grabZones.reserve(numberOfLeds);
+
+    for (int i = 0; i < numberOfLeds; i++)
     {
-        DEBUG_LOW_LEVEL << Q_FUNC_INFO << "First widget initialization";
+        GrabZone zone;
+        zone.rect = GrabberBase::grabRectOfGeometry(QRect(Settings::getLedPosition(i), Settings::getLedSize(i)));
+        zone.isAreaEnabled = Settings::isLedEnabled(i);
+        m_grabZones << zone;
+    }
+}
 
-        GrabWidget * ledWidget = new GrabWidget(m_ledWidgets.size(), m_parentWidget);
+void GrabManager::createLedWidgets()
+{
+    DEBUG_LOW_LEVEL << Q_FUNC_INFO << m_grabZones.size();
+
+    for (int i = m_ledWidgets.size(); i < m_grabZones.size(); i++)
+    {
+        // widget loads its geometry and state from settings
+        GrabWidget * ledWidget = new GrabWidget(i, m_parentWidget);
 
         connect(ledWidget, SIGNAL(resizeOrMoveStarted()), this, SLOT(pauseWhileResizeOrMoving()));
         connect(ledWidget, SIGNAL(resizeOrMoveCompleted(int)), this, SLOT(resumeAfterResizeOrMoving()));
+        connect(ledWidget, SIGNAL(resizeOrMoveCompleted(int)), this, SLOT(updateGrabZones()));
+        connect(ledWidget, SIGNAL(areaEnabledChanged(int,bool)), this, SLOT(updateGrabZones()));
 
-// TODO: Check out this line!
-//         First LED widget using to determine grabbing-monitor in WinAPI version of Grab
-//        connect(ledWidget, SIGNAL(resizeOrMoveCompleted(int)), this, SLOT(firstWidgetPositionChanged()));
+        if (m_isGrabWidgetsColored)
+            ledWidget->fillBackgroundColored();
+        else
+            ledWidget->fillBackgroundWhite();
 
-        m_ledWidgets << ledWidget;
+        ledWidget->show();
 
-//        firstWidgetPositionChanged();
+        m_ledWidgets << ledWidget;
     }
+}
 
-    int diff = numberOfLeds - m_ledWidgets.size();
-
-    if (diff > 0)
-    {
-        DEBUG_LOW_LEVEL << Q_FUNC_INFO << "Append" << diff << "grab widgets";
-
-        for (int i = 0; i < diff; i++)
-        {
-            GrabWidget * ledWidget = new GrabWidget(m_ledWidgets.size(), m_parentWidget);
-
-            connect(ledWidget, SIGNAL(resizeOrMoveStarted()), this, SLOT(pauseWhileResizeOrMoving()));
-            connect(ledWidget, SIGNAL(resizeOrMoveCompleted(int)), this, SLOT(resumeAfterResizeOrMoving()));
-
-            m_ledWidgets << ledWidget;
-        }
-    } else {
-        diff *= -1;
-        DEBUG_LOW_LEVEL << Q_FUNC_INFO << "Remove last" << diff << "grab widgets";
+void GrabManager::destroyLedWidgets()
+{
+    DEBUG_LOW_LEVEL << Q_FUNC_INFO << m_ledWidgets.size();
 
-        while (diff --> 0)
-        {
-            m_ledWidgets.last()->deleteLater();
-            m_ledWidgets.removeLast();
-        }
-    }
+    // grab widget may be deleted from its own signal handler
+    for (int i = 0; i < m_ledWidgets.size(); i++)
+        m_ledWidgets[i]->deleteLater();
 
-    if (m_ledWidgets.size() != numberOfLeds)
-        qCritical() << Q_FUNC_INFO << "Fail: m_ledWidgets.size()" << m_ledWidgets.size() << " != numberOfLeds" << numberOfLeds;
+    m_ledWidgets.clear();
+    m_isPauseGrabWhileResizeOrMoving = false;
 }
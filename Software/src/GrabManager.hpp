@@ -35,14 +35,16 @@
 #include "QtGrabber.hpp"
 #include "QtGrabberEachWidget.hpp"
 #include "X11Grabber.hpp"
+#include "XcbShmGrabber.hpp"
 #include "MacOSGrabber.hpp"
 #include "D3D9Grabber.hpp"
 #include "D3D10Grabber.hpp"
+#include "ReplayGrabber.hpp"
+#include "FrameSourceGrabber.hpp"
+#include "GrabberContext.hpp"
 
 #include "enums.hpp"
 
-class GrabberContext;
-
 class GrabManager : public QObject
 {
     Q_OBJECT
@@ -51,8 +53,20 @@ public:
     GrabManager(QWidget *parent = 0);
     virtual ~GrabManager();
 
+    /*!
+      Frames the active grabber skipped because nothing changed under grab widgets
+    */
+    quint32 skippedFramesCount() const;
+    /*!
+      Grab deadlines the active grabber missed because grabbing didn't keep up with the rate
+    */
+    quint32 missedDeadlinesCount() const;
+
 signals:
-    void updateLedsColors(const QList<QRgb> & colors);
+    /*!
+      \param frameId id of the grabbed frame the colors come from, see FrameTracer
+    */
+    void updateLedsColors(const QList<QRgb> & colors, quint64 frameId);
     void ambilightTimeOfUpdatingColors(double ms);
     void changeScreen();
 
@@ -64,9 +78,28 @@ public:
     void setNumberOfLeds(int numberOfLeds);
     void reset();
 
+    /*!
+      Records screens grabbed by any grabber to \a path until stopFrameRecording()
+    */
+    bool startFrameRecording(const QString &path);
+    void stopFrameRecording();
+    /*!
+      Switches to \a ReplayGrabber fed from the recording at \a path
+      \param isRealtime keep the recorded timing, otherwise replay as fast as possible
+    */
+    void replayFrames(const QString &path, bool isRealtime);
+    /*!
+      Switches to \a FrameSourceGrabber reading frames from \a source, see FrameSourceDefs.hpp
+    */
+    void grabFrameSource(const QString &source);
+
 public slots:
     void onGrabberTypeChanged(const Grab::GrabberType grabberType);
     void onGrabSlowdownChanged(int ms);
+    void onGrabTargetFpsChanged(double fps);
+    void onGrabSubsamplingStepChanged(int step);
+    void onGrabAdaptiveRateEnabledChanged(bool isEnabled);
+    void onGrabAdaptiveSlowdownMaxChanged(int ms);
     void onGrabAvgColorsEnabledChanged(bool state);
     void onSendDataOnlyIfColorsEnabledChanged(bool state);
     void start(bool isGrabEnabled);
@@ -85,15 +118,27 @@ private slots:
     void onFrameGrabAttempted(GrabResult result);
     void updateScreenGeometry();
     void onScreenCountChanged(int);
+    void updateGrabZones();
 
 private:
     GrabberBase *queryGrabber(Grab::GrabberType grabber);
     void initGrabbers();
     GrabberBase *initGrabber(GrabberBase *grabber);
+    void startGrabber(GrabberBase *grabber);
+    void stopGrabber(GrabberBase *grabber);
+    bool isGrabberStarted(GrabberBase *grabber) const;
+    void switchGrabber(GrabberBase *grabber);
+    int motionOfFrame(const QList<QRgb> &colors);
+    void updateAdaptiveRate(int motion);
+    void setCurrentSlowdown(int ms);
+    void setGrabberInterval(GrabberBase *grabber, int ms, Qt::ConnectionType type = Qt::AutoConnection);
+    int baseSlowdownMs() const;
     void initColorLists(int numberOfLeds);
     void clearColorsNew();
     void clearColorsCurrent();
-    void initLedWidgets(int numberOfLeds);
+    void loadGrabZones(int numberOfLeds);
+    void createLedWidgets();
+    void destroyLedWidgets();
 
 private:
     QList<GrabberBase*> m_grabbers;
@@ -108,6 +153,8 @@ private:
     QTimer *m_timerUpdateFPS;
     QThread *m_grabbersThread;
     QWidget *m_parentWidget;
+    // Zones grabbed for LEDs, widgets editing them exist only while they are shown
+    QList<GrabZone> m_grabZones;
     QList<GrabWidget *> m_ledWidgets;
     QList<QRgb> m_grabResult;
     const static QColor m_backgroundAndTextColors[10][2];
@@ -115,6 +162,16 @@ private:
 
     QList<QRgb> m_colorsCurrent;
     QList<QRgb> m_colorsNew;
+    QList<QRgb> m_colorsLastGrabbed;
+    quint64 m_colorsFrameId;
+
+    // Adaptive grab rate: interval is kept between m_grabSlowdownMs and m_adaptiveSlowdownMaxMs
+    bool m_isAdaptiveRateEnabled;
+    int m_grabSlowdownMs;
+    double m_grabTargetFps; // replaces m_grabSlowdownMs for grabbers with fractional rates if it isn't zero
+    int m_adaptiveSlowdownMaxMs;
+    int m_currentSlowdownMs;
+    int m_staticFramesCount;
 
     QRect m_screenSavedRect;
     int m_screenSavedIndex;
@@ -127,5 +184,6 @@ private:
     double m_fpsMs;
 
     bool m_isGrabWidgetsVisible;
+    bool m_isGrabWidgetsColored;
     GrabberContext * m_grabberContext;
 };
@@ -88,6 +88,7 @@ GrabWidget::~GrabWidget()
 {
     DEBUG_LOW_LEVEL << Q_FUNC_INFO << m_selfId;
 
+    delete m_configWidget;
     delete ui;
 }
 
@@ -555,6 +556,8 @@ void GrabWidget::onIsAreaEnabled_Toggled(bool state)
     Settings::setLedEnabled(m_selfId, state);
 
     fillBackgroundColored();    
+
+    emit areaEnabledChanged(m_selfId, state);
 }
 
 void GrabWidget::onOpenConfigButton_Clicked()
@@ -57,6 +57,7 @@ signals:
     void resizeOrMoveCompleted(int id);
     void mouseRightButtonClicked(int selfId);
     void sizeAndPositionChanged(int w, int h, int x, int y);
+    void areaEnabledChanged(int id, bool isEnabled);
 
 public slots:
     void settingsProfileChanged();
@@ -28,6 +28,7 @@
 #include "PrismatikMath.hpp"
 #include "Settings.hpp"
 #include "debug.h"
+#include "FrameTracer.hpp"
 #include "stdio.h"
 #include <QtSerialPort/QSerialPortInfo>
 
@@ -73,7 +74,7 @@ void LedDeviceAdalight::setColors(const QList<QRgb> & colors)
     resizeColorsBuffer(colors.count());
 
     applyColorModifications(colors, m_colorsBuffer);
-
+    reduceTo8bit(m_colorsBuffer);
 
     m_writeBuffer.clear();
     m_writeBuffer.append(m_writeBufferHeader);
@@ -82,10 +83,6 @@ void LedDeviceAdalight::setColors(const QList<QRgb> & colors)
     {
         StructRgb color = m_colorsBuffer[i];
 
-        color.r = color.r >> 4;
-        color.g = color.g >> 4;
-        color.b = color.b >> 4;
-
         if (m_colorSequence == "RBG")
         {
             m_writeBuffer.append(color.r);
@@ -253,6 +250,7 @@ bool LedDeviceAdalight::writeBuffer(const QByteArray & buff)
     if (m_AdalightDevice == NULL || m_AdalightDevice->isOpen() == false)
         return false;
 
+    FrameTraceScope trace("serial write", m_frameId);
     int bytesWritten = m_AdalightDevice->write(buff);
 
     if (bytesWritten != buff.count())
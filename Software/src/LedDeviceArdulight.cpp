@@ -28,6 +28,7 @@
 #include "PrismatikMath.hpp"
 #include "Settings.hpp"
 #include "debug.h"
+#include "FrameTracer.hpp"
 #include "stdio.h"
 #include <QtSerialPort/QSerialPortInfo>
 
@@ -76,11 +77,9 @@ void LedDeviceArdulight::setColors(const QList<QRgb> & colors)
     resizeColorsBuffer(colors.count());
 
     applyColorModifications(colors, m_colorsBuffer);
+    reduceTo8bit(m_colorsBuffer);
 
     for(int i=0; i < m_colorsBuffer.count(); i++) {
-        m_colorsBuffer[i].r = m_colorsBuffer[i].r >> 4;
-        m_colorsBuffer[i].g = m_colorsBuffer[i].g >> 4;
-        m_colorsBuffer[i].b = m_colorsBuffer[i].b >> 4;
         PrismatikMath::maxCorrection(254, m_colorsBuffer[i]);
     }
 
@@ -260,6 +259,7 @@ bool LedDeviceArdulight::writeBuffer(const QByteArray & buff)
     if (m_ArdulightDevice == NULL || m_ArdulightDevice->isOpen() == false)
         return false;
 
+    FrameTraceScope trace("serial write", m_frameId);
     int bytesWritten = m_ArdulightDevice->write(buff);
 
     if (bytesWritten != buff.count())
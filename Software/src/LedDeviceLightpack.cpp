@@ -29,6 +29,7 @@
 #include <algorithm>
 #include <QtDebug>
 #include "debug.h"
+#include "FrameTracer.hpp"
 #include "Settings.hpp"
 #include <QApplication>
 
@@ -341,6 +342,7 @@ bool LedDeviceLightpack::writeBufferToDevice(int command, hid_device *phid_devic
 #if 0
     DEBUG_LOW_LEVEL << Q_FUNC_INFO << "thread id: " << this->thread()->currentThreadId();
 #endif
+    FrameTraceScope trace("hid write", m_frameId);
 
     m_writeBuffer[WRITE_BUFFER_INDEX_REPORT_ID] = 0x00;
     m_writeBuffer[WRITE_BUFFER_INDEX_COMMAND] = command;
@@ -37,6 +37,8 @@
 #include "LedDeviceArdulight.hpp"
 #include "LedDeviceVirtual.hpp"
 #include "Settings.hpp"
+#include "PipelineStats.hpp"
+#include "FrameTracer.hpp"
 
 using namespace SettingsScope;
 
@@ -46,13 +48,18 @@ LedDeviceManager::LedDeviceManager(QObject *parent)
     m_isLastCommandCompleted = true;
 
     m_ledDeviceThread = new QThread();
+    m_ledDeviceThread->setObjectName("LedDeviceThread");
 
     m_backlightStatus = Backlight::StatusOn;
 
     m_isColorsSaved = false;
+    m_savedFrameId = 0;
 
     m_cmdTimeoutTimer = NULL;
 
+    m_colorsQueueDelayNs = 0;
+    m_isColorsWriting = false;
+
     for (int i = 0; i < SupportedDevices::DeviceTypesCount; i++)
         m_ledDevices.append(NULL);
 }
@@ -96,24 +103,33 @@ void LedDeviceManager::switchOnLeds()
 
     m_backlightStatus = Backlight::StatusOn;
     if (m_isColorsSaved)
-        emit ledDeviceSetColors(m_savedColors);
+        emit ledDeviceSetColors(m_savedColors, m_savedFrameId);
 }
 
-void LedDeviceManager::setColors(const QList<QRgb> & colors)
+void LedDeviceManager::setColors(const QList<QRgb> & colors, quint64 frameId)
 {
     DEBUG_MID_LEVEL << Q_FUNC_INFO << "Is last command completed:" << m_isLastCommandCompleted
                     << " m_backlightStatus = " << m_backlightStatus;
 
     if (m_backlightStatus == Backlight::StatusOn)
     {
+        // colors waiting for the device are replaced
+        if (!m_isLastCommandCompleted && m_cmdQueue.contains(LedDeviceCommands::SetColors))
+            FrameTracer::instant("coalesced", m_savedFrameId);
+
         m_savedColors = colors;
+        m_savedFrameId = frameId;
         m_isColorsSaved = true;
         if (m_isLastCommandCompleted)
         {
             m_cmdTimeoutTimer->start();
             m_isLastCommandCompleted = false;
-            emit ledDeviceSetColors(colors);
+            startColorsWrite(0);
+            emit ledDeviceSetColors(colors, frameId);
         } else {
+            // only the newest colors are written, waiting time is counted from the oldest dropped ones
+            if (!m_cmdQueue.contains(LedDeviceCommands::SetColors))
+                m_colorsQueuedTimer.start();
             cmdQueueAppend(LedDeviceCommands::SetColors);
         }
     }
@@ -309,6 +325,13 @@ void LedDeviceManager::ledDeviceCommandCompleted(bool ok)
 
     m_cmdTimeoutTimer->stop();
 
+    if (m_isColorsWriting)
+    {
+        m_isColorsWriting = false;
+        PipelineStats::record(PipelineStage::DeviceQueue, m_colorsQueueDelayNs);
+        PipelineStats::record(PipelineStage::DeviceWrite, m_colorsWriteTimer.nsecsElapsed());
+    }
+
     if (ok)
     {
         if (m_cmdQueue.isEmpty() == false)
@@ -418,7 +441,7 @@ void LedDeviceManager::connectSignalSlotsLedDevice()
     connect(m_ledDevice, SIGNAL(colorsUpdated(QList<QRgb>)),    this, SIGNAL(setColors_VirtualDeviceCallback(QList<QRgb>)), Qt::QueuedConnection);
 
     connect(this, SIGNAL(ledDeviceOpen()),                      m_ledDevice, SLOT(open()), Qt::QueuedConnection);
-    connect(this, SIGNAL(ledDeviceSetColors(QList<QRgb>)),      m_ledDevice, SLOT(setColors(QList<QRgb>)), Qt::QueuedConnection);
+    connect(this, SIGNAL(ledDeviceSetColors(QList<QRgb>,quint64)), m_ledDevice, SLOT(setFrameColors(QList<QRgb>,quint64)), Qt::QueuedConnection);
     connect(this, SIGNAL(ledDeviceOffLeds()),                   m_ledDevice, SLOT(switchOffLeds()), Qt::QueuedConnection);
     connect(this, SIGNAL(ledDeviceSetRefreshDelay(int)),        m_ledDevice, SLOT(setRefreshDelay(int)), Qt::QueuedConnection);
     connect(this, SIGNAL(ledDeviceSetColorDepth(int)),          m_ledDevice, SLOT(setColorDepth(int)), Qt::QueuedConnection);
@@ -449,7 +472,7 @@ void LedDeviceManager::disconnectSignalSlotsLedDevice()
     disconnect(m_ledDevice, SIGNAL(colorsUpdated(QList<QRgb>)), this, SIGNAL(setColors_VirtualDeviceCallback(QList<QRgb>)));
 
     disconnect(this, SIGNAL(ledDeviceOpen()),                   m_ledDevice, SLOT(open()));
-    disconnect(this, SIGNAL(ledDeviceSetColors(QList<QRgb>)),   m_ledDevice, SLOT(setColors(QList<QRgb>)));
+    disconnect(this, SIGNAL(ledDeviceSetColors(QList<QRgb>,quint64)), m_ledDevice, SLOT(setFrameColors(QList<QRgb>,quint64)));
     disconnect(this, SIGNAL(ledDeviceOffLeds()),                m_ledDevice, SLOT(switchOffLeds()));
     disconnect(this, SIGNAL(ledDeviceSetRefreshDelay(int)),     m_ledDevice, SLOT(setRefreshDelay(int)));
     disconnect(this, SIGNAL(ledDeviceSetColorDepth(int)),       m_ledDevice, SLOT(setColorDepth(int)));
@@ -474,6 +497,15 @@ void LedDeviceManager::cmdQueueAppend(LedDeviceCommands::Cmd cmd)
     }
 }
 
+void LedDeviceManager::startColorsWrite(qint64 queueDelayNs)
+{
+    m_colorsQueueDelayNs = queueDelayNs;
+    m_isColorsWriting = true;
+    m_colorsWriteTimer.start();
+    if (queueDelayNs > 0)
+        FrameTracer::complete("device queue", m_savedFrameId, FrameTracer::nowNs() - queueDelayNs, queueDelayNs);
+}
+
 void LedDeviceManager::cmdQueueProcessNext()
 {
     DEBUG_MID_LEVEL << Q_FUNC_INFO << m_cmdQueue;
@@ -494,7 +526,8 @@ void LedDeviceManager::cmdQueueProcessNext()
         case LedDeviceCommands::SetColors:
             if (m_isColorsSaved) {
                 m_cmdTimeoutTimer->start();
-                emit ledDeviceSetColors(m_savedColors);
+                startColorsWrite(m_colorsQueuedTimer.nsecsElapsed());
+                emit ledDeviceSetColors(m_savedColors, m_savedFrameId);
             }
             break;
 
@@ -28,6 +28,7 @@
 
 #include "enums.hpp"
 #include "AbstractLedDevice.hpp"
+#include <QElapsedTimer>
 
 class QTimer;
 
@@ -51,7 +52,7 @@ signals:
 
     // This signals are directly connected to ILedDevice. Don't use outside.
     void ledDeviceOpen();
-    void ledDeviceSetColors(const QList<QRgb> & colors);
+    void ledDeviceSetColors(const QList<QRgb> & colors, quint64 frameId);
     void ledDeviceOffLeds();
     void ledDeviceSetRefreshDelay(int value);
     void ledDeviceSetColorDepth(int value);
@@ -71,7 +72,7 @@ public slots:
     void recreateLedDevice(const SupportedDevices::DeviceType deviceType);
 
     // This slots are protected from the overflow of queries
-    void setColors(const QList<QRgb> & colors);
+    void setColors(const QList<QRgb> & colors, quint64 frameId = 0);
     void switchOffLeds();
     void switchOnLeds();
     void setRefreshDelay(int value);
@@ -98,6 +99,7 @@ private:
     void cmdQueueAppend(LedDeviceCommands::Cmd);
     void cmdQueueProcessNext();
     void processOffLeds();
+    void startColorsWrite(qint64 queueDelayNs);
 
 private:
     bool m_isLastCommandCompleted;
@@ -107,6 +109,7 @@ private:
     QList<LedDeviceCommands::Cmd> m_cmdQueue;
 
     QList<QRgb> m_savedColors;
+    quint64 m_savedFrameId;
     int m_savedRefreshDelay;
     int m_savedColorDepth;
     int m_savedSmoothSlowdown;
@@ -120,4 +123,10 @@ private:
     AbstractLedDevice *m_ledDevice;
     QThread *m_ledDeviceThread;
     QTimer *m_cmdTimeoutTimer;
+
+    // output stage timings, see PipelineStats
+    QElapsedTimer m_colorsQueuedTimer;
+    QElapsedTimer m_colorsWriteTimer;
+    qint64 m_colorsQueueDelayNs;
+    bool m_isColorsWriting;
 };
@@ -34,9 +34,15 @@
 #include "PluginsManager.hpp"
 #include "wizard/Wizard.hpp"
 #include "Plugin.hpp"
+#include "FrameTracer.hpp"
 
+#include <QElapsedTimer>
+#include <QFile>
 #include <stdio.h>
 #include <iostream>
+#ifdef Q_OS_LINUX
+#include <unistd.h>
+#endif
 
 using namespace std;
 using namespace SettingsScope;
@@ -50,12 +56,16 @@ public:
 
 LightpackApplication::LightpackApplication(int &argc, char **argv)
     : QtSingleApplication(argc, argv)
+    , m_settingsWindow(NULL)
 {
     DEBUG_LOW_LEVEL << Q_FUNC_INFO;
 }
 
 void LightpackApplication::initializeAll(const QString & appDirPath)
 {
+    QElapsedTimer startupTimer;
+    startupTimer.start();
+
     setApplicationName("Prismatik");
     setOrganizationName("Pixelkit LLC");
     setApplicationVersion(VERSION_STR);
@@ -63,15 +73,18 @@ void LightpackApplication::initializeAll(const QString & appDirPath)
 
     m_applicationDirPath = appDirPath;
     m_noGui = false;
+    m_isReplayRealtime = true;
 
 
     processCommandLineArguments();
 
 	printVersionsSoftwareQtOS();
 
-    if (!Settings::Initialize(m_applicationDirPath, m_isDebugLevelObtainedFromCmdArgs)
-            && !m_noGui) {
-        runWizardLoop(false);
+    if (!Settings::Initialize(m_applicationDirPath, m_isDebugLevelObtainedFromCmdArgs)) {
+        if (m_noGui)
+            qWarning() << "Settings not found, running headless with defaults. Use --wizard once to configure the device";
+        else
+            runWizardLoop(false);
     }
 
     m_isSettingsWindowActive = false;
@@ -111,16 +124,29 @@ void LightpackApplication::initializeAll(const QString & appDirPath)
     }
     m_deviceLockStatus = DeviceLocked::Unlocked;
 
+    if (!m_traceFramesPath.isEmpty())
+        FrameTracer::start(m_traceFramesPath);
+
     startLedDeviceManager();
 
     startApiServer();
 
     initGrabManager();
 
+    if (!m_replayFramesPath.isEmpty())
+        m_grabManager->replayFrames(m_replayFramesPath, m_isReplayRealtime);
+    else if (!m_frameSource.isEmpty())
+        m_grabManager->grabFrameSource(m_frameSource);
+    if (!m_recordFramesPath.isEmpty())
+        m_grabManager->startFrameRecording(m_recordFramesPath);
+
     if (!m_noGui)
     {
         connect(m_settingsWindow, SIGNAL(backlightStatusChanged(Backlight::Status)), this, SLOT(setStatusChanged(Backlight::Status)));
         m_settingsWindow->startBacklight();
+    } else {
+        // there is no window to report the initial status, start as it would
+        startBacklight();
     }
 
     this->settingsChanged();
@@ -135,6 +161,28 @@ void LightpackApplication::initializeAll(const QString & appDirPath)
 		this->installNativeEventFilter(iter.get());
 
     emit postInitialization();
+
+    qDebug() << "Initialized" << (m_noGui ? "headless" : "with GUI") << "in" << startupTimer.elapsed() << "ms,"
+             << "resident set size" << residentSetSizeKiB() << "KiB";
+}
+
+/*!
+  Resident memory of the process, -1 where it is not known
+*/
+qint64 LightpackApplication::residentSetSizeKiB()
+{
+#ifdef Q_OS_LINUX
+    QFile statm("/proc/self/statm");
+    if (!statm.open(QIODevice::ReadOnly))
+        return -1;
+    // size resident shared text lib data dt, in pages
+    const QList<QByteArray> fields = statm.readAll().split(' ');
+    if (fields.size() < 2)
+        return -1;
+    return fields[1].toLongLong() * (sysconf(_SC_PAGESIZE) / 1024);
+#else
+    return -1;
+#endif
 }
 
 void LightpackApplication::runWizardLoop(bool isInitFromSettings)
@@ -151,7 +199,7 @@ void LightpackApplication::runWizardLoop(bool isInitFromSettings)
 HWND LightpackApplication::getMainWindowHandle() {
     // to get HWND sometimes needed to activate window
 //    winFocus(m_settingsWindow, true);
-    return reinterpret_cast<HWND>(m_settingsWindow->winId());
+    return m_settingsWindow ? reinterpret_cast<HWND>(m_settingsWindow->winId()) : NULL;
 }
 
 bool LightpackApplication::winEventFilter ( MSG * msg, long * result ) {
@@ -298,16 +346,34 @@ void LightpackApplication::processCommandLineArguments()
 
     for (int i = 1; i < arguments().count(); i++)
     {
-        if (arguments().at(i) == "--nogui")
+        if (arguments().at(i) == "--nogui" || arguments().at(i) == "--headless")
         {
             m_noGui = true;
-            DEBUG_LOW_LEVEL <<  "Application running no_GUI mode";
+            DEBUG_LOW_LEVEL <<  "Application running headless mode";
         }
         else if (arguments().at(i) == "--wizard")
         {
             bool isInitFromSettings = Settings::Initialize(m_applicationDirPath, false);
             runWizardLoop(isInitFromSettings);
         }
+        else if ((arguments().at(i) == "--record-frames" || arguments().at(i) == "--replay-frames" || arguments().at(i) == "--frame-source"
+                  || arguments().at(i) == "--trace-frames")
+                 && i + 1 < arguments().count())
+        {
+            if (arguments().at(i) == "--record-frames")
+                m_recordFramesPath = arguments().at(i + 1);
+            else if (arguments().at(i) == "--trace-frames")
+                m_traceFramesPath = arguments().at(i + 1);
+            else if (arguments().at(i) == "--replay-frames")
+                m_replayFramesPath = arguments().at(i + 1);
+            else
+                m_frameSource = arguments().at(i + 1);
+            ++i;
+        }
+        else if (arguments().at(i) == "--replay-fast")
+        {
+            m_isReplayRealtime = false;
+        }
         else if (arguments().at(i) == "--off")
         {
             LedDeviceLightpack lightpackDevice;
@@ -362,9 +428,15 @@ void LightpackApplication::printHelpMessage() const
     fprintf(stderr, "Build with Qt version %s\n", QT_VERSION_STR);
     fprintf(stderr, "\n");
     fprintf(stderr, "Options: \n");
-    fprintf(stderr, "  --nogui       - no GUI (console mode) \n");
+    fprintf(stderr, "  --headless    - no settings window, tray and zone widgets, for always-on setups \n");
+    fprintf(stderr, "  --nogui       - the same as --headless \n");
     fprintf(stderr, "  --wizard      - run settings wizard first \n");
     fprintf(stderr, "  --off         - send 'off leds' cmd to device \n");
+    fprintf(stderr, "  --record-frames <file> - record grabbed frames to the file \n");
+    fprintf(stderr, "  --replay-frames <file> - grab frames recorded earlier instead of the screen \n");
+    fprintf(stderr, "  --replay-fast  - replay frames as fast as possible, not at the recorded timing \n");
+    fprintf(stderr, "  --frame-source <fifo|shm:/name> - grab raw frames written by another program \n");
+    fprintf(stderr, "  --trace-frames <file> - write spans of every frame to a trace event JSON file for chrome://tracing \n");
     fprintf(stderr, "  --help        - show this help \n");
     fprintf(stderr, "  --debug-high  - maximum verbose level of debug output\n");
     fprintf(stderr, "  --debug-mid   - middle debug level\n");
@@ -494,6 +566,7 @@ void LightpackApplication::startLedDeviceManager()
     DEBUG_LOW_LEVEL << Q_FUNC_INFO;
     m_ledDeviceManager = new LedDeviceManager();
     m_LedDeviceManagerThread = new QThread();
+    m_LedDeviceManagerThread->setObjectName("LedDeviceManagerThread");
 
 //    connect(settings(), SIGNAL(connectedDeviceChanged(const SupportedDevices::DeviceType)), this, SLOT(handleConnectedDeviceChange(const SupportedDevices::DeviceType)), Qt::DirectConnection);
 //    connect(settings(), SIGNAL(adalightSerialPortNameChanged(QString)),               m_ledDeviceManager, SLOT(recreateLedDevice()), Qt::DirectConnection);
@@ -529,6 +602,10 @@ void LightpackApplication::startLedDeviceManager()
     connect(settings(), SIGNAL(deviceRefreshDelayChanged(int)),     m_ledDeviceManager, SLOT(setRefreshDelay(int)), Qt::QueuedConnection);
     connect(settings(), SIGNAL(deviceGammaChanged(double)),         m_ledDeviceManager, SLOT(setGamma(double)), Qt::QueuedConnection);
     connect(settings(), SIGNAL(deviceBrightnessChanged(int)),       m_ledDeviceManager, SLOT(setBrightness(int)), Qt::QueuedConnection);
+    // LUT and dithering are read by the device with other settings, they have no UI to be reapplied from on profile switch
+    connect(settings(), SIGNAL(deviceColorLutChanged(QString)),     m_ledDeviceManager, SLOT(updateDeviceSettings()), Qt::QueuedConnection);
+    connect(settings(), SIGNAL(deviceDitheringEnabledChanged(bool)), m_ledDeviceManager, SLOT(updateDeviceSettings()), Qt::QueuedConnection);
+    connect(settings(), SIGNAL(profileLoaded(const QString &)),     m_ledDeviceManager, SLOT(updateDeviceSettings()), Qt::QueuedConnection);
 //    connect(settings(), SIGNAL(deviceColorSequenceChanged(QString)),m_ledDeviceManager, SLOT(setColorSequence(QString)), Qt::QueuedConnection);
     connect(settings(), SIGNAL(luminosityThresholdChanged(int))      ,m_ledDeviceManager, SLOT(setLuminosityThreshold(int)), Qt::QueuedConnection);
     connect(settings(), SIGNAL(minimumLuminosityEnabledChanged(bool)),m_ledDeviceManager, SLOT(setMinimumLuminosityEnabled(bool)), Qt::QueuedConnection);
@@ -592,6 +669,10 @@ void LightpackApplication::initGrabManager()
 
     connect(settings(), SIGNAL(grabberTypeChanged(const Grab::GrabberType &)), m_grabManager, SLOT(onGrabberTypeChanged(const Grab::GrabberType &)), Qt::QueuedConnection);
     connect(settings(), SIGNAL(grabSlowdownChanged(int)), m_grabManager, SLOT(onGrabSlowdownChanged(int)), Qt::QueuedConnection);
+    connect(settings(), SIGNAL(grabTargetFpsChanged(double)), m_grabManager, SLOT(onGrabTargetFpsChanged(double)), Qt::QueuedConnection);
+    connect(settings(), SIGNAL(grabSubsamplingStepChanged(int)), m_grabManager, SLOT(onGrabSubsamplingStepChanged(int)), Qt::QueuedConnection);
+    connect(settings(), SIGNAL(grabAdaptiveRateEnabledChanged(bool)), m_grabManager, SLOT(onGrabAdaptiveRateEnabledChanged(bool)), Qt::QueuedConnection);
+    connect(settings(), SIGNAL(grabAdaptiveSlowdownMaxChanged(int)), m_grabManager, SLOT(onGrabAdaptiveSlowdownMaxChanged(int)), Qt::QueuedConnection);
     connect(settings(), SIGNAL(grabAvgColorsEnabledChanged(bool)), m_grabManager, SLOT(onGrabAvgColorsEnabledChanged(bool)), Qt::QueuedConnection);
 
     connect(settings(), SIGNAL(profileLoaded(const QString &)),        m_grabManager, SLOT(settingsProfileChanged(const QString &)), Qt::QueuedConnection);
@@ -610,9 +691,9 @@ void LightpackApplication::initGrabManager()
         connect(m_grabManager, SIGNAL(ambilightTimeOfUpdatingColors(double)), m_settingsWindow, SLOT(refreshAmbilightEvaluated(double)));
     }
 
-    connect(m_grabManager, SIGNAL(updateLedsColors(const QList<QRgb> &)),    m_ledDeviceManager, SLOT(setColors(QList<QRgb>)), Qt::QueuedConnection);
+    connect(m_grabManager, SIGNAL(updateLedsColors(const QList<QRgb> &, quint64)), m_ledDeviceManager, SLOT(setColors(QList<QRgb>, quint64)), Qt::QueuedConnection);
     connect(m_moodlampManager, SIGNAL(updateLedsColors(const QList<QRgb> &)),    m_ledDeviceManager, SLOT(setColors(QList<QRgb>)), Qt::QueuedConnection);
-    connect(m_grabManager, SIGNAL(updateLedsColors(const QList<QRgb> &)), m_pluginInterface, SLOT(updateColors(const QList<QRgb> &)), Qt::QueuedConnection);
+    connect(m_grabManager, SIGNAL(updateLedsColors(const QList<QRgb> &, quint64)), m_pluginInterface, SLOT(updateColors(const QList<QRgb> &)), Qt::QueuedConnection);
     connect(m_moodlampManager, SIGNAL(updateLedsColors(const QList<QRgb> &)), m_pluginInterface, SLOT(updateColors(const QList<QRgb> &)), Qt::QueuedConnection);
     connect(m_grabManager, SIGNAL(ambilightTimeOfUpdatingColors(double)), m_pluginInterface, SLOT(refreshAmbilightEvaluated(double)));
     connect(m_grabManager,SIGNAL(changeScreen(QRect)),m_pluginInterface,SLOT(refreshScreenRect(QRect)));
@@ -644,7 +725,8 @@ void LightpackApplication::commitData(QSessionManager &sessionManager)
     if (m_ledDeviceManager != NULL)
     {
         // Disable signals with new colors
-        disconnect(m_settingsWindow, SIGNAL(updateLedsColors(QList<QRgb>)),  m_ledDeviceManager, SLOT(setColors(QList<QRgb>)));
+        if (m_settingsWindow != NULL)
+            disconnect(m_settingsWindow, SIGNAL(updateLedsColors(QList<QRgb>)),  m_ledDeviceManager, SLOT(setColors(QList<QRgb>)));
         disconnect(m_apiServer, SIGNAL(updateLedsColors(QList<QRgb>)),  m_ledDeviceManager, SLOT(setColors(QList<QRgb>)));
 
         // Process all currently pending signals
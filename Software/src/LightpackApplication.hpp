@@ -51,6 +51,7 @@ public:
     HWND getMainWindowHandle();
 #endif
     SettingsWindow * settingsWnd() { return m_settingsWindow; }
+    LedDeviceManager * ledDeviceManager() { return m_ledDeviceManager; }
     const SettingsScope::Settings * settings() { return SettingsScope::Settings::settingsSingleton(); }
     enum ErrorCodes {
         OK_ErrorCode                            = 0,
@@ -89,6 +90,7 @@ private:
     void printHelpMessage() const;
     void printVersionsSoftwareQtOS() const;
     bool checkSystemTrayAvailability() const;
+    static qint64 residentSetSizeKiB();
     void startApiServer();
     void startLedDeviceManager();
     void initGrabManager();
@@ -124,6 +126,11 @@ private:
     bool m_isDebugLevelObtainedFromCmdArgs;
     bool m_isApiServerConnectedToLedDeviceSignalsSlots;
     bool m_noGui;
+    QString m_recordFramesPath;
+    QString m_replayFramesPath;
+    QString m_frameSource;
+    QString m_traceFramesPath;
+    bool m_isReplayRealtime;
     DeviceLocked::DeviceLockStatus m_deviceLockStatus;
     bool m_isSettingsWindowActive;
     Backlight::Status m_backlightStatus;
@@ -0,0 +1,160 @@
+/*
+ * PipelineStats.cpp
+ *
+ *     Project: Prismatik
+ *
+ *  Prismatik is a free, open-source software: you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as published
+ *  by the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Prismatik and Lightpack files is distributed in the hope that it will be
+ *  useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "PipelineStats.hpp"
+#include <limits.h>
+
+namespace {
+int highestBit(quint64 value)
+{
+    int bit = 0;
+    if (value >> 32) { value >>= 32; bit += 32; }
+    if (value >> 16) { value >>= 16; bit += 16; }
+    if (value >> 8) { value >>= 8; bit += 8; }
+    if (value >> 4) { value >>= 4; bit += 4; }
+    if (value >> 2) { value >>= 2; bit += 2; }
+    if (value >> 1) { bit += 1; }
+    return bit;
+}
+}
+
+int LatencyHistogram::bucketOf(qint64 durationNs)
+{
+    if (durationNs < SubBucketsCount)
+        return durationNs > 0 ? static_cast<int>(durationNs) : 0;
+
+    const quint64 maxValue = (Q_UINT64_C(1) << MaxBits) - 1;
+    const quint64 value = qMin(static_cast<quint64>(durationNs), maxValue);
+    const int bit = highestBit(value);
+    // the highest bit is implied, next SubBucketBits bits select the sub-bucket
+    const int subBucket = static_cast<int>(value >> (bit - SubBucketBits)) - SubBucketsCount;
+    return SubBucketsCount * (bit - SubBucketBits + 1) + subBucket;
+}
+
+qint64 LatencyHistogram::bucketUpperBound(int bucket)
+{
+    if (bucket < SubBucketsCount)
+        return bucket;
+
+    const int shift = bucket / SubBucketsCount - 1;
+    const qint64 lowerBound = static_cast<qint64>(SubBucketsCount + bucket % SubBucketsCount) << shift;
+    return lowerBound + (Q_INT64_C(1) << shift) - 1;
+}
+
+void LatencyHistogram::record(qint64 durationNs)
+{
+    m_buckets[bucketOf(durationNs)].ref();
+
+    const int durationUs = static_cast<int>(qMin(durationNs / 1000, static_cast<qint64>(INT_MAX)));
+    int maxUs = m_maxUs.load();
+    while (durationUs > maxUs && !m_maxUs.testAndSetRelaxed(maxUs, durationUs))
+        maxUs = m_maxUs.load();
+}
+
+LatencyHistogram::Summary LatencyHistogram::summary() const
+{
+    int counts[BucketsCount];
+    int count = 0;
+    for (int i = 0; i < BucketsCount; ++i) {
+        counts[i] = m_buckets[i].load();
+        count += counts[i];
+    }
+
+    Summary result;
+    result.count = count;
+    if (count == 0)
+        return result;
+
+    // ranks are rounded up, p99 of 10 samples is the largest one
+    const qint64 p50Rank = (static_cast<qint64>(count) * 50 + 99) / 100;
+    const qint64 p95Rank = (static_cast<qint64>(count) * 95 + 99) / 100;
+    const qint64 p99Rank = (static_cast<qint64>(count) * 99 + 99) / 100;
+
+    qint64 cumulative = 0;
+    for (int i = 0; i < BucketsCount; ++i) {
+        if (counts[i] == 0)
+            continue;
+        const qint64 previous = cumulative;
+        cumulative += counts[i];
+        if (previous < p50Rank && cumulative >= p50Rank)
+            result.p50Ns = bucketUpperBound(i);
+        if (previous < p95Rank && cumulative >= p95Rank)
+            result.p95Ns = bucketUpperBound(i);
+        if (previous < p99Rank && cumulative >= p99Rank)
+            result.p99Ns = bucketUpperBound(i);
+    }
+    // max is exact to a microsecond, keep percentiles rounded up to bucket bounds below it
+    result.maxNs = qMax(static_cast<qint64>(m_maxUs.load()) * 1000, result.p99Ns);
+    return result;
+}
+
+void LatencyHistogram::reset()
+{
+    for (int i = 0; i < BucketsCount; ++i)
+        m_buckets[i].store(0);
+    m_maxUs.store(0);
+}
+
+LatencyHistogram PipelineStats::m_histograms[PipelineStage::StagesCount];
+
+void PipelineStats::record(PipelineStage::Stage stage, qint64 durationNs)
+{
+    m_histograms[stage].record(durationNs);
+}
+
+LatencyHistogram::Summary PipelineStats::summary(PipelineStage::Stage stage)
+{
+    return m_histograms[stage].summary();
+}
+
+void PipelineStats::reset()
+{
+    for (int i = 0; i < PipelineStage::StagesCount; ++i)
+        m_histograms[i].reset();
+}
+
+const char * PipelineStats::stageName(PipelineStage::Stage stage)
+{
+    static const char * const stageNames[PipelineStage::StagesCount] = {
+        "capture", "averaging", "handover", "postprocessing", "devicequeue", "devicewrite"
+    };
+    return stageNames[stage];
+}
+
+QString PipelineStats::summaryText()
+{
+    QString summary;
+    for (int i = 0; i < PipelineStage::StagesCount; ++i) {
+        const PipelineStage::Stage stage = static_cast<PipelineStage::Stage>(i);
+        const LatencyHistogram::Summary stageSummary = PipelineStats::summary(stage);
+        if (stageSummary.count == 0) {
+            summary += QString("%1: idle; ").arg(stageName(stage));
+            continue;
+        }
+        summary += QString("%1: %2 frames, p50/p95/p99/max %3/%4/%5/%6 us; ")
+                .arg(stageName(stage))
+                .arg(stageSummary.count)
+                .arg(stageSummary.p50Ns / 1000)
+                .arg(stageSummary.p95Ns / 1000)
+                .arg(stageSummary.p99Ns / 1000)
+                .arg(stageSummary.maxNs / 1000);
+    }
+    return summary;
+}
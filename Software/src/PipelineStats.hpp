@@ -0,0 +1,104 @@
+/*
+ * PipelineStats.hpp
+ *
+ *     Project: Prismatik
+ *
+ *  Prismatik is a free, open-source software: you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as published
+ *  by the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Prismatik and Lightpack files is distributed in the hope that it will be
+ *  useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <QtGlobal>
+#include <QAtomicInt>
+#include <QString>
+
+namespace PipelineStage
+{
+enum Stage {
+    Capture,        // grabbing screens, grabbers thread
+    Averaging,      // zone averaging, grabbers thread
+    Handover,       // waiting for the GUI thread to take the grabbed frame
+    PostProcessing, // colors processing in GrabManager
+    DeviceQueue,    // waiting in LedDeviceManager for the previous command to complete
+    DeviceWrite,    // colors correction and writing to the device, device thread
+    StagesCount
+};
+}
+
+/*!
+  Log-linear histogram of durations: values below 16 ns are exact, above that every power of two
+  is split into 16 buckets, so percentiles are within 1/16 of the recorded value.
+  Recording is a couple of atomic operations and is safe from any thread, no locks are taken.
+*/
+class LatencyHistogram
+{
+public:
+    enum {
+        SubBucketBits = 4,
+        SubBucketsCount = 1 << SubBucketBits,
+        MaxBits = 40, // ~18 minutes, longer durations are counted in the last bucket
+        BucketsCount = SubBucketsCount * (MaxBits - SubBucketBits + 1)
+    };
+
+    struct Summary {
+        Summary()
+            : count(0)
+            , p50Ns(0)
+            , p95Ns(0)
+            , p99Ns(0)
+            , maxNs(0)
+        {}
+        int count;
+        qint64 p50Ns;
+        qint64 p95Ns;
+        qint64 p99Ns;
+        qint64 maxNs;
+    };
+
+    void record(qint64 durationNs);
+    Summary summary() const;
+    void reset();
+
+    static int bucketOf(qint64 durationNs);
+    /*!
+      Largest duration counted in the \a bucket
+    */
+    static qint64 bucketUpperBound(int bucket);
+
+private:
+    QAtomicInt m_buckets[BucketsCount];
+    QAtomicInt m_maxUs;
+};
+
+/*!
+  Latency histograms of every stage of the grab pipeline, collected since start or the last reset.
+*/
+class PipelineStats
+{
+public:
+    static void record(PipelineStage::Stage stage, qint64 durationNs);
+    static LatencyHistogram::Summary summary(PipelineStage::Stage stage);
+    static void reset();
+
+    static const char * stageName(PipelineStage::Stage stage);
+
+    /*!
+      One line dump of all stages, microseconds
+    */
+    static QString summaryText();
+
+private:
+    static LatencyHistogram m_histograms[PipelineStage::StagesCount];
+};
@@ -146,6 +146,10 @@ static const QString Grabber = "Grab/Grabber";
 static const QString IsAvgColorsEnabled = "Grab/IsAvgColorsEnabled";
 static const QString IsSendDataOnlyIfColorsChanges = "Grab/IsSendDataOnlyIfColorsChanges";
 static const QString Slowdown = "Grab/Slowdown";
+static const QString TargetFps = "Grab/TargetFps";
+static const QString SubsamplingStep = "Grab/SubsamplingStep";
+static const QString IsAdaptiveRateEnabled = "Grab/IsAdaptiveRateEnabled";
+static const QString AdaptiveSlowdownMax = "Grab/AdaptiveSlowdownMax";
 static const QString LuminosityThreshold = "Grab/LuminosityThreshold";
 static const QString IsMinimumLuminosityEnabled = "Grab/IsMinimumLuminosityEnabled";
 static const QString IsDx1011GrabberEnabled = "Grab/IsDX1011GrabberEnabled";
@@ -165,6 +169,8 @@ static const QString Smooth = "Device/Smooth";
 static const QString Brightness = "Device/Brightness";
 static const QString ColorDepth = "Device/ColorDepth";
 static const QString Gamma = "Device/Gamma";
+static const QString ColorLut = "Device/ColorLut";
+static const QString IsDitheringEnabled = "Device/IsDitheringEnabled";
 }
 // [LED_i]
 namespace Led
@@ -196,6 +202,7 @@ static const QString QtEachWidget = "QtEachWidget";
 static const QString WinAPI = "WinAPI";
 static const QString WinAPIEachWidget = "WinAPIEachWidget";
 static const QString X11 = "X11";
+static const QString XcbShm = "XcbShm";
 static const QString D3D9 = "D3D9";
 static const QString MacCoreGraphics = "MacCoreGraphics";
 }
@@ -902,6 +909,60 @@ void Settings::setGrabSlowdown(int value)
     m_this->grabSlowdownChanged(value);
 }
 
+double Settings::getGrabTargetFps()
+{
+    DEBUG_LOW_LEVEL << Q_FUNC_INFO;
+    return getValidGrabTargetFps(value(Profile::Key::Grab::TargetFps).toDouble());
+}
+
+void Settings::setGrabTargetFps(double fps)
+{
+    DEBUG_LOW_LEVEL << Q_FUNC_INFO;
+    fps = getValidGrabTargetFps(fps);
+    setValue(Profile::Key::Grab::TargetFps, fps);
+    m_this->grabTargetFpsChanged(fps);
+}
+
+int Settings::getGrabSubsamplingStep()
+{
+    DEBUG_LOW_LEVEL << Q_FUNC_INFO;
+    return getValidGrabSubsamplingStep(value(Profile::Key::Grab::SubsamplingStep).toInt());
+}
+
+void Settings::setGrabSubsamplingStep(int value)
+{
+    DEBUG_LOW_LEVEL << Q_FUNC_INFO;
+    value = getValidGrabSubsamplingStep(value);
+    setValue(Profile::Key::Grab::SubsamplingStep, value);
+    m_this->grabSubsamplingStepChanged(value);
+}
+
+bool Settings::isGrabAdaptiveRateEnabled()
+{
+    return value(Profile::Key::Grab::IsAdaptiveRateEnabled).toBool();
+}
+
+void Settings::setGrabAdaptiveRateEnabled(bool isEnabled)
+{
+    DEBUG_LOW_LEVEL << Q_FUNC_INFO;
+    setValue(Profile::Key::Grab::IsAdaptiveRateEnabled, isEnabled);
+    m_this->grabAdaptiveRateEnabledChanged(isEnabled);
+}
+
+int Settings::getGrabAdaptiveSlowdownMax()
+{
+    DEBUG_LOW_LEVEL << Q_FUNC_INFO;
+    return getValidGrabSlowdown(value(Profile::Key::Grab::AdaptiveSlowdownMax).toInt());
+}
+
+void Settings::setGrabAdaptiveSlowdownMax(int value)
+{
+    DEBUG_LOW_LEVEL << Q_FUNC_INFO;
+    value = getValidGrabSlowdown(value);
+    setValue(Profile::Key::Grab::AdaptiveSlowdownMax, value);
+    m_this->grabAdaptiveSlowdownMaxChanged(value);
+}
+
 bool Settings::isBacklightEnabled()
 {
     return value(Profile::Key::IsBacklightEnabled).toBool();
@@ -1022,6 +1083,30 @@ void Settings::setDeviceGamma(double gamma)
     m_this->deviceGammaChanged(gamma);
 }
 
+QString Settings::getDeviceColorLut()
+{
+    return value(Profile::Key::Device::ColorLut).toString();
+}
+
+void Settings::setDeviceColorLut(const QString &cubePath)
+{
+    DEBUG_LOW_LEVEL << Q_FUNC_INFO;
+    setValue(Profile::Key::Device::ColorLut, cubePath);
+    m_this->deviceColorLutChanged(cubePath);
+}
+
+bool Settings::isDeviceDitheringEnabled()
+{
+    return value(Profile::Key::Device::IsDitheringEnabled).toBool();
+}
+
+void Settings::setDeviceDitheringEnabled(bool isEnabled)
+{
+    DEBUG_LOW_LEVEL << Q_FUNC_INFO;
+    setValue(Profile::Key::Device::IsDitheringEnabled, isEnabled);
+    m_this->deviceDitheringEnabledChanged(isEnabled);
+}
+
 Grab::GrabberType Settings::getGrabberType()
 {
     DEBUG_LOW_LEVEL << Q_FUNC_INFO;
@@ -1054,6 +1139,11 @@ Grab::GrabberType Settings::getGrabberType()
         return Grab::GrabberTypeX11;
 #endif
 
+#ifdef XCB_SHM_GRAB_SUPPORT
+    if (strGrabber == Profile::Value::GrabberType::XcbShm)
+        return Grab::GrabberTypeXcbShm;
+#endif
+
 #ifdef MAC_OS_CG_GRAB_SUPPORT
     if (strGrabber == Profile::Value::GrabberType::MacCoreGraphics)
         return Grab::GrabberTypeMacCoreGraphics;
@@ -1101,6 +1191,12 @@ void Settings::setGrabberType(Grab::GrabberType grabberType)
         break;
 #endif
 
+#ifdef XCB_SHM_GRAB_SUPPORT
+    case Grab::GrabberTypeXcbShm:
+        strGrabber = Profile::Value::GrabberType::XcbShm;
+        break;
+#endif
+
 #ifdef MAC_OS_CG_GRAB_SUPPORT
     case Grab::GrabberTypeMacCoreGraphics:
         strGrabber = Profile::Value::GrabberType::MacCoreGraphics;
@@ -1349,6 +1445,28 @@ int Settings::getValidGrabSlowdown(int value)
     return value;
 }
 
+double Settings::getValidGrabTargetFps(double value)
+{
+    // zero turns target fps off
+    if (value <= 0)
+        return 0;
+    return qBound(Profile::Grab::TargetFpsMin, value, Profile::Grab::TargetFpsMax);
+}
+
+int Settings::getValidGrabSubsamplingStep(int value)
+{
+    if (value < Profile::Grab::SubsamplingStepMin)
+        value = Profile::Grab::SubsamplingStepMin;
+    else if (value > Profile::Grab::SubsamplingStepMax)
+        value = Profile::Grab::SubsamplingStepMax;
+
+    // round down to power of two: 1, 2, 4, 8
+    int step = 1;
+    while (step * 2 <= value)
+        step *= 2;
+    return step;
+}
+
 int Settings::getValidMoodLampSpeed(int value)
 {
     if (value < Profile::MoodLamp::SpeedMin)
@@ -1436,6 +1554,10 @@ void Settings::initCurrentProfile(bool isResetDefault)
     setNewOption(Profile::Key::Grab::IsAvgColorsEnabled, Profile::Grab::IsAvgColorsEnabledDefault, isResetDefault);
     setNewOption(Profile::Key::Grab::IsSendDataOnlyIfColorsChanges, Profile::Grab::IsSendDataOnlyIfColorsChangesDefault, isResetDefault);
     setNewOption(Profile::Key::Grab::Slowdown,      Profile::Grab::SlowdownDefault, isResetDefault);
+    setNewOption(Profile::Key::Grab::TargetFps,     Profile::Grab::TargetFpsDefault, isResetDefault);
+    setNewOption(Profile::Key::Grab::SubsamplingStep, Profile::Grab::SubsamplingStepDefault, isResetDefault);
+    setNewOption(Profile::Key::Grab::IsAdaptiveRateEnabled, Profile::Grab::IsAdaptiveRateEnabledDefault, isResetDefault);
+    setNewOption(Profile::Key::Grab::AdaptiveSlowdownMax, Profile::Grab::AdaptiveSlowdownMaxDefault, isResetDefault);
     setNewOption(Profile::Key::Grab::LuminosityThreshold, Profile::Grab::MinimumLevelOfSensitivityDefault, isResetDefault);
     setNewOption(Profile::Key::Grab::IsMinimumLuminosityEnabled, Profile::Grab::IsMinimumLuminosityEnabledDefault, isResetDefault);
     // [MoodLamp]
@@ -1447,6 +1569,8 @@ void Settings::initCurrentProfile(bool isResetDefault)
     setNewOption(Profile::Key::Device::Brightness,  Profile::Device::BrightnessDefault, isResetDefault);
     setNewOption(Profile::Key::Device::Smooth,      Profile::Device::SmoothDefault, isResetDefault);
     setNewOption(Profile::Key::Device::Gamma,       Profile::Device::GammaDefault, isResetDefault);
+    setNewOption(Profile::Key::Device::ColorLut,    Profile::Device::ColorLutDefault, isResetDefault);
+    setNewOption(Profile::Key::Device::IsDitheringEnabled, Profile::Device::IsDitheringEnabledDefault, isResetDefault);
     setNewOption(Profile::Key::Device::ColorDepth,  Profile::Device::ColorDepthDefault, isResetDefault);
 
 
@@ -139,6 +139,17 @@ public:
     // Profile
     static int getGrabSlowdown();
     static void setGrabSlowdown(int value);
+    /*!
+      Fractional grab rate (e.g. 23.976) used instead of Slowdown, 0 if it is off
+    */
+    static double getGrabTargetFps();
+    static void setGrabTargetFps(double fps);
+    static int getGrabSubsamplingStep();
+    static void setGrabSubsamplingStep(int value);
+    static bool isGrabAdaptiveRateEnabled();
+    static void setGrabAdaptiveRateEnabled(bool isEnabled);
+    static int getGrabAdaptiveSlowdownMax();
+    static void setGrabAdaptiveSlowdownMax(int value);
     static bool isBacklightEnabled();
     static void setIsBacklightEnabled(bool isEnabled);
     static bool isGrabAvgColorsEnabled();
@@ -160,6 +171,16 @@ public:
     static void setDeviceColorDepth(int value);
     static double getDeviceGamma();
     static void setDeviceGamma(double gamma);
+    /*!
+      .cube 3D LUT applied by the device before gamma, empty for none
+    */
+    static QString getDeviceColorLut();
+    static void setDeviceColorLut(const QString &cubePath);
+    /*!
+      temporal dithering of 12bit colors sent to 8bit serial devices
+    */
+    static bool isDeviceDitheringEnabled();
+    static void setDeviceDitheringEnabled(bool isEnabled);
 
     static Grab::GrabberType getGrabberType();
     static void setGrabberType(Grab::GrabberType grabMode);
@@ -205,6 +226,8 @@ private:
     static int getValidDeviceColorDepth(int value);
     static double getValidDeviceGamma(double value);
     static int getValidGrabSlowdown(int value);
+    static double getValidGrabTargetFps(double value);
+    static int getValidGrabSubsamplingStep(int value);
     static int getValidMoodLampSpeed(int value);
     static int getValidLuminosityThreshold(int value);
     static void setValidLedCoef(int ledIndex, const QString & keyCoef, double coef);
@@ -255,6 +278,10 @@ signals:
     void ardulightNumberOfLedsChanged(int numberOfLeds);
     void virtualNumberOfLedsChanged(int numberOfLeds);
     void grabSlowdownChanged(int value);
+    void grabTargetFpsChanged(double fps);
+    void grabSubsamplingStepChanged(int value);
+    void grabAdaptiveRateEnabledChanged(bool isEnabled);
+    void grabAdaptiveSlowdownMaxChanged(int value);
     void backlightEnabledChanged(bool isEnabled);
     void grabAvgColorsEnabledChanged(bool isEnabled);
     void sendDataOnlyIfColorsChangesChanged(bool isEnabled);
@@ -265,6 +292,8 @@ signals:
     void deviceSmoothChanged(int value);
     void deviceColorDepthChanged(int value);
     void deviceGammaChanged(double gamma);
+    void deviceColorLutChanged(const QString &cubePath);
+    void deviceDitheringEnabledChanged(bool isEnabled);
     void deviceColorSequenceChanged(QString value);
     void grabberTypeChanged(const Grab::GrabberType grabMode);
     void dx1011GrabberEnabledChanged(const bool isEnabled);
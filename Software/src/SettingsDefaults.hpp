@@ -141,9 +141,20 @@ static const bool IsMinimumLuminosityEnabledDefault = true;
 static const int SlowdownMin = 1;
 static const int SlowdownDefault = 50;
 static const int SlowdownMax = 1000;
+// TargetFps replaces Slowdown when it isn't zero
+static const double TargetFpsMin = 1.0;
+static const double TargetFpsDefault = 0.0;
+static const double TargetFpsMax = 1000.0;
 static const int MinimumLevelOfSensitivityMin = 0;
 static const int MinimumLevelOfSensitivityDefault = 3;
 static const int MinimumLevelOfSensitivityMax = 100;
+// Only every N-th pixel of every N-th row is averaged, N is a power of two
+static const int SubsamplingStepMin = 1;
+static const int SubsamplingStepDefault = 1;
+static const int SubsamplingStepMax = 8;
+// Adaptive rate slows grabbing down from Slowdown up to AdaptiveSlowdownMax while the picture is static
+static const bool IsAdaptiveRateEnabledDefault = false;
+static const int AdaptiveSlowdownMaxDefault = 200;
 }
 // [MoodLamp]
 namespace MoodLamp
@@ -176,6 +187,9 @@ static const int ColorDepthMax = 255;
 static const double GammaMin = 0.01;
 static const double GammaDefault = 2.0;
 static const double GammaMax = 10.0;
+
+static const QString ColorLutDefault = "";
+static const bool IsDitheringEnabledDefault = false;
 }
 // [LED_i]
 namespace Led
@@ -242,6 +242,9 @@ void SettingsWindow::connectSignalsSlots()
 #ifdef X11_GRAB_SUPPORT
     connect(ui->radioButton_GrabX11, SIGNAL(toggled(bool)), this, SLOT(onGrabberChanged()));
 #endif
+#ifdef XCB_SHM_GRAB_SUPPORT
+    connect(ui->radioButton_GrabXcbShm, SIGNAL(toggled(bool)), this, SLOT(onGrabberChanged()));
+#endif
 #ifdef MAC_OS_CG_GRAB_SUPPORT
     connect(ui->radioButton_GrabMacCoreGraphics, SIGNAL(toggled(bool)), this, SLOT(onGrabberChanged()));
 #endif
@@ -762,6 +765,9 @@ void SettingsWindow::initGrabbersRadioButtonsVisibility()
 #else
     ui->radioButton_GrabX11->setChecked(true);
 #endif
+#ifndef XCB_SHM_GRAB_SUPPORT
+    ui->radioButton_GrabXcbShm->setVisible(false);
+#endif
 #ifndef MAC_OS_CG_GRAB_SUPPORT
     ui->radioButton_GrabMacCoreGraphics->setVisible(false);
 #else
@@ -1576,6 +1582,11 @@ void SettingsWindow::updateUiFromSettings()
         ui->radioButton_GrabX11->setChecked(true);
         break;
 #endif
+#ifdef XCB_SHM_GRAB_SUPPORT
+    case Grab::GrabberTypeXcbShm:
+        ui->radioButton_GrabXcbShm->setChecked(true);
+        break;
+#endif
 #ifdef MAC_OS_CG_GRAB_SUPPORT
     case Grab::GrabberTypeMacCoreGraphics:
         ui->radioButton_GrabMacCoreGraphics->setChecked(true);
@@ -1606,6 +1617,11 @@ Grab::GrabberType SettingsWindow::getSelectedGrabberType()
         return Grab::GrabberTypeX11;
     }
 #endif
+#ifdef XCB_SHM_GRAB_SUPPORT
+    if (ui->radioButton_GrabXcbShm->isChecked()) {
+        return Grab::GrabberTypeXcbShm;
+    }
+#endif
 #ifdef WINAPI_GRAB_SUPPORT
     if (ui->radioButton_GrabWinAPI->isChecked()) {
         return Grab::GrabberTypeWinAPI;
@@ -26,18 +26,20 @@
 
 #pragma once
 
+#include <QElapsedTimer>
+
 class TimeEvaluations
 {
 
 public:
-    TimeEvaluations() : timevalue_ms(-1)
-    {
-    }
-
     void howLongItStart();
+
+    /*!
+      Milliseconds since howLongItStart() on a monotonic clock, -1 if it wasn't started
+    */
     double howLongItEnd();
 
 private:
-    double timevalue_ms;
+    QElapsedTimer timer;
 };
 
@@ -64,10 +64,13 @@ enum GrabberType {
     GrabberTypeQt,
     GrabberTypeQtEachWidget,
     GrabberTypeX11,
+    GrabberTypeXcbShm,
     GrabberTypeWinAPI,
     GrabberTypeWinAPIEachWidget,
     GrabberTypeD3D9,
     GrabberTypeMacCoreGraphics,
+    GrabberTypeReplay, // frames recorded earlier, selected from the command line only
+    GrabberTypeFrameSource, // raw frames from a pipe or shared memory, selected from the command line only
 
     GrabbersCount,
 
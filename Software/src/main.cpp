@@ -34,6 +34,7 @@
 #include "Settings.hpp"
 #include "version.h"
 #include "debug.h"
+#include "FrameTracer.hpp"
 
 #include "SettingsWizard.hpp"
 
@@ -245,6 +246,8 @@ int main(int argc, char **argv)
 
     int returnCode = lightpackApp.exec();
 
+    FrameTracer::stop();
+
 #ifdef Q_OS_MACX
     if (endActivityRequired)
       [[NSProcessInfo processInfo] endActivity: activity];
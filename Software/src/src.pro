@@ -127,7 +127,7 @@ unix:!macx{
     # Linux version using libusb and hidapi codes
     SOURCES += hidapi/linux/hid-libusb.c
     # For QSerialDevice
-    LIBS += -ludev -lrt -lXext -lX11
+    LIBS += -ludev -lrt -lXrandr -lXdamage -lXfixes -lXext -lX11 -lxcb-shm -lxcb
 }
 
 macx{
@@ -179,6 +179,9 @@ SOURCES += \
     Plugin.cpp \
     LightpackPluginInterface.cpp \
     TimeEvaluations.cpp \
+    PipelineStats.cpp \
+    FrameTracer.cpp \
+    ColorLut.cpp \
     EndSessionDetector.cpp \
     wizard/ZoneWidget.cpp \
     wizard/ZonePlacementPage.cpp \
@@ -203,6 +206,9 @@ HEADERS += \
     SettingsDefaults.hpp \
     version.h \
     TimeEvaluations.hpp \
+    PipelineStats.hpp \
+    FrameTracer.hpp \
+    ColorLut.hpp \
     GrabManager.hpp \
     GrabWidget.hpp \
     GrabConfigWidget.hpp \
@@ -1,4 +1,42 @@
 #include "GrabCalculationTest.hpp"
+#include <string.h>
+#include "FrameSourceGrabber.hpp"
+#include "ReplayGrabber.hpp"
+#include "X11Grabber.hpp"
+
+#ifdef FRAME_SOURCE_GRAB_SUPPORT
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+class ShmFrameSourceGrabber : public FrameSourceGrabber
+{
+public:
+    ShmFrameSourceGrabber(GrabberContext *context) : FrameSourceGrabber(NULL, context) {}
+
+    using FrameSourceGrabber::isGrabbedFrameIntact;
+};
+
+// writes frame \a sequence of b, g, r, a pixels to its slot and publishes it
+void publishShmFrame(unsigned char *shm, quint64 sequence, unsigned char blue)
+{
+    FRAMESOURCE_SHM_HEADER *header = reinterpret_cast<FRAMESOURCE_SHM_HEADER *>(shm);
+    unsigned char *slot = shm + header->dataOffset + ((sequence - 1) % header->slotsCount) * header->slotSize;
+    for (uint32_t y = 0; y < header->height; ++y) {
+        unsigned char *pixel = slot + y * header->bytesPerLine;
+        for (uint32_t x = 0; x < header->width; ++x, pixel += 4) {
+            pixel[0] = blue;
+            pixel[1] = 20;
+            pixel[2] = 30;
+            pixel[3] = 0;
+        }
+    }
+    __atomic_store_n(&header->writeSequence, sequence, __ATOMIC_RELEASE);
+}
+}
+#endif
 
 void GrabCalculationTest::testCase1()
 {
@@ -8,3 +46,580 @@ void GrabCalculationTest::testCase1()
     QVERIFY2(Grab::Calculations::calculateAvgColor(&result, buf, BufferFormatArgb, 16, QRect(0,0,4,1)) == 0xfa, "Failure. calculateAvgColor returned wrong errorcode");
     QCOMPARE(result, qRgb(0xfa,0xfa,0xfa));
 }
+
+void GrabCalculationTest::testAccumulationKernelsMatchScalar()
+{
+    using namespace Grab::Calculations;
+
+    const int width = 64;
+    const int height = 16;
+    const unsigned int pitch = width * 4;
+    QVector<unsigned char> buf(pitch * height);
+    qsrand(93);
+    for (int i = 0; i < buf.size(); ++i)
+        buf[i] = qrand() & 0xff;
+
+    const BufferFormat formats[] = { BufferFormatArgb, BufferFormatBgra, BufferFormatRgba, BufferFormatAbgr };
+    const QRect rects[] = { QRect(0, 0, 4, 1), QRect(4, 3, 8, 5), QRect(12, 1, 20, 15), QRect(0, 0, width, height) };
+
+    const AccumulationKernel initialKernel = accumulationKernel();
+    for (int f = 0; f < 4; ++f) {
+        for (int r = 0; r < 4; ++r) {
+            QRgb expected, actual;
+            setAccumulationKernel(AccumulationKernelScalar);
+            calculateAvgColor(&expected, buf.constData(), formats[f], pitch, rects[r]);
+
+            for (int k = AccumulationKernelSse2; k <= bestAccumulationKernel(); ++k) {
+                QVERIFY(setAccumulationKernel(static_cast<AccumulationKernel>(k)));
+                calculateAvgColor(&actual, buf.constData(), formats[f], pitch, rects[r]);
+                QVERIFY2(actual == expected, accumulationKernelName(static_cast<AccumulationKernel>(k)));
+            }
+        }
+    }
+    setAccumulationKernel(initialKernel);
+}
+
+void GrabCalculationTest::testStepTwoKernelMatchesScalar()
+{
+    using namespace Grab::Calculations;
+
+    if (bestAccumulationKernel() < AccumulationKernelAvx2)
+        QSKIP("AVX2 is not supported by the CPU");
+
+    const int width = 64;
+    const int height = 16;
+    const unsigned int pitch = width * 4;
+    QVector<unsigned char> buf(pitch * height);
+    qsrand(57);
+    for (int i = 0; i < buf.size(); ++i)
+        buf[i] = qrand() & 0xff;
+
+    // widths of 4 + 8n pixels end with a tail of two even pixels, heights are odd
+    const QRect rects[] = {
+        QRect(0, 0, 4, 1), QRect(4, 0, 8, 1), QRect(8, 2, 12, 3), QRect(20, 1, 20, 7),
+        QRect(4, 5, 36, 9), QRect(0, 0, 60, 15), QRect(0, 0, width, height)
+    };
+    const int rectsCount = sizeof(rects) / sizeof(rects[0]);
+
+    const AccumulationKernel initialKernel = accumulationKernel();
+    for (int r = 0; r < rectsCount; ++r) {
+        QRgb expected, actual;
+        setAccumulationKernel(AccumulationKernelScalar);
+        calculateAvgColor(&expected, buf.constData(), BufferFormatArgb, pitch, rects[r], 2);
+
+        QVERIFY(setAccumulationKernel(AccumulationKernelAvx2));
+        calculateAvgColor(&actual, buf.constData(), BufferFormatArgb, pitch, rects[r], 2);
+        QCOMPARE(actual, expected);
+    }
+    setAccumulationKernel(initialKernel);
+}
+
+void GrabCalculationTest::testScanlinePlanMatchesPerZone()
+{
+    using namespace Grab::Calculations;
+
+    const int width = 64;
+    const int height = 16;
+    const unsigned int pitch = width * 4;
+    QVector<unsigned char> buf(pitch * height);
+    qsrand(17);
+    for (int i = 0; i < buf.size(); ++i)
+        buf[i] = qrand() & 0xff;
+
+    // overlapping, nested, single-row and empty zones
+    QVector<QRect> zones;
+    zones << QRect(0, 0, 16, 4) << QRect(8, 2, 24, 10) << QRect(12, 3, 4, 1)
+          << QRect(40, 0, 24, 16) << QRect(20, 5, 0, 3) << QRect(0, 0, width, height);
+
+    ScanlinePlan plan;
+    buildScanlinePlan(&plan, zones);
+    QCOMPARE(plan.zones, zones);
+
+    const BufferFormat formats[] = { BufferFormatArgb, BufferFormatBgra, BufferFormatRgba, BufferFormatAbgr };
+    for (int f = 0; f < 4; ++f) {
+        QVector<QRgb> colors;
+        QVERIFY(calculateAvgColors(&colors, buf.constData(), formats[f], pitch, plan));
+        QCOMPARE(colors.size(), zones.size());
+        for (int i = 0; i < zones.size(); ++i) {
+            QRgb expected = qRgb(0, 0, 0);
+            if (zones[i].isValid())
+                calculateAvgColor(&expected, buf.constData(), formats[f], pitch, zones[i]);
+            QCOMPARE(colors[i], expected);
+        }
+    }
+}
+
+void GrabCalculationTest::testScanlineSpansAreDisjoint()
+{
+    using namespace Grab::Calculations;
+
+    const int width = 64;
+    const int height = 16;
+    const unsigned int pitch = width * 4;
+    QVector<unsigned char> buf(pitch * height);
+    qsrand(41);
+    for (int i = 0; i < buf.size(); ++i)
+        buf[i] = qrand() & 0xff;
+
+    // edges not aligned by 4 and not sharing columns with step 2
+    QVector<QRect> zones;
+    zones << QRect(0, 0, 16, 8) << QRect(6, 2, 20, 10) << QRect(10, 4, 8, 2)
+          << QRect(3, 0, 12, 16) << QRect(30, 1, 4, 4) << QRect(31, 3, 8, 6);
+
+    for (int step = 1; step <= 2; ++step) {
+        ScanlinePlan plan;
+        buildScanlinePlan(&plan, zones, step);
+
+        for (int row = 0; row + 1 < plan.rowOffsets.size(); ++row) {
+            const int y = plan.top + row;
+            QVector<int> reads(width, 0);
+            for (int s = plan.rowOffsets[row]; s < plan.rowOffsets[row + 1]; ++s) {
+                const ScanlineSpan &span = plan.spans[s];
+                for (int x = span.x; x < span.x + span.width; x += step) {
+                    ++reads[x];
+                    // zones of the span are exactly the zones taking the pixel
+                    for (int i = 0; i < zones.size(); ++i) {
+                        const bool isTaken = zones[i].contains(x, y)
+                                && (y - zones[i].top()) % step == 0 && (x - zones[i].left()) % step == 0;
+                        bool isInSpan = false;
+                        for (int z = span.firstZone; z < span.firstZone + span.zonesCount; ++z)
+                            isInSpan = isInSpan || plan.spanZones[z] == i;
+                        QCOMPARE(isInSpan, isTaken);
+                    }
+                }
+            }
+            for (int x = 0; x < width; ++x)
+                QVERIFY(reads[x] <= 1);
+        }
+
+        // pixel 10,4 is shared by zones 0, 1, 2 and 3 and is read once
+        const int row = 4 - plan.top;
+        int sharedReads = 0;
+        for (int s = plan.rowOffsets[row]; s < plan.rowOffsets[row + 1]; ++s) {
+            const ScanlineSpan &span = plan.spans[s];
+            if (span.x <= 10 && 10 < span.x + span.width && (10 - span.x) % step == 0) {
+                ++sharedReads;
+                QCOMPARE(span.zonesCount, step == 1 ? 4 : 3);
+            }
+        }
+        QCOMPARE(sharedReads, 1);
+
+        QVector<QRgb> colors;
+        QVERIFY(calculateAvgColors(&colors, buf.constData(), BufferFormatArgb, pitch, plan));
+        for (int i = 0; i < zones.size(); ++i) {
+            QRgb expected;
+            calculateAvgColor(&expected, buf.constData(), BufferFormatArgb, pitch, zones[i], step);
+            QCOMPARE(colors[i], expected);
+        }
+    }
+}
+
+void GrabCalculationTest::testIntegralImageMatchesScanline()
+{
+    using namespace Grab::Calculations;
+
+    const int width = 64;
+    const int height = 16;
+    const unsigned int pitch = width * 4;
+    QVector<unsigned char> buf(pitch * height);
+    qsrand(29);
+    for (int i = 0; i < buf.size(); ++i)
+        buf[i] = qrand() & 0xff;
+
+    QVector<QRect> zones;
+    zones << QRect(4, 1, 16, 4) << QRect(8, 2, 24, 10) << QRect(12, 3, 4, 1)
+          << QRect(40, 0, 24, 16) << QRect(20, 5, 0, 3) << QRect(0, 0, width, height);
+
+    ScanlinePlan plan;
+    buildScanlinePlan(&plan, zones);
+    QCOMPARE(plan.bounds, QRect(0, 0, width, height));
+
+    const ZoneAveraging initialZoneAveraging = zoneAveraging();
+    const BufferFormat formats[] = { BufferFormatArgb, BufferFormatBgra, BufferFormatRgba, BufferFormatAbgr };
+    IntegralImage integralImage;
+    for (int f = 0; f < 4; ++f) {
+        QVector<QRgb> expected, actual;
+        setZoneAveraging(ZoneAveragingScanline);
+        QVERIFY(calculateAvgColors(&expected, buf.constData(), formats[f], pitch, plan));
+        setZoneAveraging(ZoneAveragingIntegralImage);
+        QVERIFY(calculateAvgColors(&actual, buf.constData(), formats[f], pitch, plan, &integralImage));
+        QCOMPARE(actual, expected);
+    }
+    setZoneAveraging(initialZoneAveraging);
+
+    // same zones are read once, zones with staggered edges cut rows into short spans
+    ScanlinePlan overlapping;
+    buildScanlinePlan(&overlapping, QVector<QRect>(8, QRect(0, 0, width, height)));
+    QVERIFY(!isIntegralImagePreferred(overlapping));
+    QVector<QRect> staggeredZones;
+    for (int i = 0; i < 9; ++i)
+        staggeredZones << QRect(i * 4, 0, 32, height);
+    ScanlinePlan staggered;
+    buildScanlinePlan(&staggered, staggeredZones);
+    QVERIFY(isIntegralImagePreferred(staggered));
+    QVERIFY(!isIntegralImagePreferred(plan));
+}
+
+void GrabCalculationTest::testFrameBufferArena()
+{
+    FrameBufferArena arena;
+
+    // small sizes are rounded to cache lines, frame sizes to huge pages
+    FrameBuffer small = arena.acquire(100);
+    QVERIFY(!small.isNull());
+    QCOMPARE(small.size, size_t(128));
+    QCOMPARE(reinterpret_cast<quintptr>(small.ptr) % FrameBufferArena::Alignment, quintptr(0));
+    const size_t frameSize = 1920 * 1080 * 4;
+    FrameBuffer frame = arena.acquire(frameSize);
+    QVERIFY(!frame.isNull());
+    QVERIFY(frame.size >= frameSize);
+    QCOMPARE(frame.size % FrameBufferArena::HugePageSize, size_t(0));
+    QCOMPARE(reinterpret_cast<quintptr>(frame.ptr) % FrameBufferArena::Alignment, quintptr(0));
+    QCOMPARE(arena.allocatedBytes(), small.size + frame.size);
+    QCOMPARE(arena.inUseBytes(), small.size + frame.size);
+    QCOMPARE(arena.peakAllocatedBytes(), small.size + frame.size);
+
+    // released buffer is handed out again for a size of the same class
+    const unsigned char *framePtr = frame.ptr;
+    arena.release(frame);
+    QCOMPARE(arena.allocatedBytes(), small.size + frame.size);
+    QCOMPARE(arena.inUseBytes(), small.size);
+    frame = arena.acquire(frameSize - 100);
+    QCOMPARE(const_cast<const unsigned char *>(frame.ptr), framePtr);
+    QCOMPARE(arena.allocatedBytes(), small.size + frame.size);
+    QCOMPARE(arena.peakAllocatedBytes(), small.size + frame.size);
+
+    // the second buffer doesn't fit under MaxFreeBytes and is freed on release
+    const size_t largeSize = FrameBufferArena::MaxFreeBytes / 2 + FrameBufferArena::HugePageSize;
+    FrameBuffer first = arena.acquire(largeSize);
+    FrameBuffer second = arena.acquire(largeSize);
+    QVERIFY(!first.isNull());
+    QVERIFY(!second.isNull());
+    const size_t peak = small.size + frame.size + first.size + second.size;
+    QCOMPARE(arena.allocatedBytes(), peak);
+    QCOMPARE(arena.peakAllocatedBytes(), peak);
+    arena.release(first);
+    QCOMPARE(arena.allocatedBytes(), peak);
+    arena.release(second);
+    QCOMPARE(arena.allocatedBytes(), peak - second.size);
+    QCOMPARE(arena.inUseBytes(), small.size + frame.size);
+    QCOMPARE(arena.peakAllocatedBytes(), peak);
+
+    // trim frees released buffers only, so the next large buffer is allocated anew
+    arena.release(frame);
+    arena.trim();
+    QCOMPARE(arena.allocatedBytes(), small.size);
+    QCOMPARE(arena.inUseBytes(), small.size);
+    FrameBuffer large = arena.acquire(largeSize);
+    QVERIFY(!large.isNull());
+    QCOMPARE(arena.allocatedBytes(), small.size + large.size);
+    QCOMPARE(arena.peakAllocatedBytes(), peak);
+
+    arena.release(large);
+    arena.release(small);
+}
+
+void GrabCalculationTest::testFrameRecordingRoundTrip()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.path() + "/frames.prfr";
+
+    QVector<unsigned char> first(8 * 4 * 4, 0x11);
+    QVector<unsigned char> second(8 * 4 * 4, 0x22);
+    QVector<unsigned char> other(4 * 2 * 4, 0x33);
+
+    RecordedScreen screen;
+    screen.rect = QRect(0, 0, 8, 4);
+    screen.format = BufferFormatBgra;
+    RecordedScreen otherScreen;
+    otherScreen.rect = QRect(8, 0, 4, 2);
+    otherScreen.format = BufferFormatArgb;
+    otherScreen.data = other.constData();
+    otherScreen.dataSize = other.size();
+
+    FrameRecorder recorder;
+    QVERIFY(recorder.start(path));
+    const unsigned char * const images[] = { first.constData(), first.constData(), second.constData() };
+    for (int i = 0; i < 3; ++i) {
+        screen.data = images[i];
+        screen.dataSize = first.size();
+        recorder.record(1000 * i, QVector<RecordedScreen>() << screen << otherScreen);
+    }
+    recorder.stop();
+    QCOMPARE(recorder.recordedFramesCount(), 3u);
+
+    // repeated images are stored once
+    QFileInfo fileInfo(path);
+    QVERIFY(fileInfo.size() < 3 * (first.size() + other.size()));
+
+    FrameRecording recording;
+    QVERIFY(recording.open(path));
+    QCOMPARE(recording.framesCount(), 3);
+    for (int i = 0; i < 3; ++i) {
+        QCOMPARE(recording.timestampNs(i), Q_INT64_C(1000) * i);
+        const QVector<RecordedScreen> screens = recording.screens(i);
+        QCOMPARE(screens.size(), 2);
+        QCOMPARE(screens[0].rect, QRect(0, 0, 8, 4));
+        QCOMPARE(screens[0].format, BufferFormatBgra);
+        QCOMPARE(screens[0].dataSize, static_cast<size_t>(first.size()));
+        QVERIFY(memcmp(screens[0].data, images[i], first.size()) == 0);
+        QCOMPARE(screens[1].rect, QRect(8, 0, 4, 2));
+        QVERIFY(memcmp(screens[1].data, other.constData(), other.size()) == 0);
+    }
+}
+
+void GrabCalculationTest::testFrameRecordingCorrupted()
+{
+    using namespace FrameRecordingFormat;
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.path() + "/frames.prfr";
+
+    QVector<unsigned char> first(8 * 4 * 4, 0x11);
+    QVector<unsigned char> second(8 * 4 * 4, 0x22);
+    RecordedScreen screen;
+    screen.rect = QRect(0, 0, 8, 4);
+    screen.format = BufferFormatBgra;
+    screen.dataSize = first.size();
+
+    FrameRecorder recorder;
+    QVERIFY(recorder.start(path));
+    screen.data = first.constData();
+    recorder.record(0, QVector<RecordedScreen>() << screen);
+    screen.data = second.constData();
+    recorder.record(1000, QVector<RecordedScreen>() << screen);
+    recorder.stop();
+
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    const QByteArray recorded = file.readAll();
+    file.close();
+
+    // frames after a corrupted header are dropped, earlier ones are kept
+    const int secondFrame = sizeof(FileHeader) + sizeof(FrameHeader) + sizeof(ScreenHeader) + first.size();
+    for (int corruption = 0; corruption < 2; ++corruption) {
+        QByteArray corrupted = recorded;
+        FrameHeader *frameHeader = reinterpret_cast<FrameHeader *>(corrupted.data() + secondFrame);
+        ScreenHeader *screenHeader = reinterpret_cast<ScreenHeader *>(corrupted.data() + secondFrame + sizeof(FrameHeader));
+        if (corruption == 0)
+            frameHeader->screensCount = 0x80000000u;
+        else
+            screenHeader->dataSize = Q_UINT64_C(0xfffffffffffffff0);
+
+        QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+        QCOMPARE(file.write(corrupted), static_cast<qint64>(corrupted.size()));
+        file.close();
+
+        FrameRecording recording;
+        QVERIFY(recording.open(path));
+        QCOMPARE(recording.framesCount(), 1);
+        QCOMPARE(recording.screens(0).size(), 1);
+        QVERIFY(memcmp(recording.screens(0)[0].data, first.constData(), first.size()) == 0);
+    }
+}
+
+void GrabCalculationTest::testReplayWithoutDisplay()
+{
+    GrabberContext context;
+    GrabZone zone;
+    zone.rect = QRect(0, 0, 8, 4);
+    zone.isAreaEnabled = true;
+    context.setGrabZones(QList<GrabZone>() << zone);
+
+#ifdef X11_GRAB_SUPPORT
+    // every grabber is created at startup, X11 one must survive a missing display
+    const QByteArray display = qgetenv("DISPLAY");
+    qunsetenv("DISPLAY");
+    {
+        X11Grabber x11Grabber(NULL, &context);
+        x11Grabber.grab();
+    }
+    if (!display.isEmpty())
+        qputenv("DISPLAY", display);
+#endif
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.path() + "/frames.prfr";
+
+    QVector<unsigned char> image;
+    for (int i = 0; i < 8 * 4; ++i)
+        image << 10 << 20 << 30 << 0;
+    RecordedScreen screen;
+    screen.rect = QRect(0, 0, 8, 4);
+    // b, g, r, a bytes
+    screen.format = BufferFormatArgb;
+    screen.data = image.constData();
+    screen.dataSize = image.size();
+
+    FrameRecorder recorder;
+    QVERIFY(recorder.start(path));
+    recorder.record(0, QVector<RecordedScreen>() << screen);
+    recorder.stop();
+
+    ReplayGrabber grabber(NULL, &context);
+    QVERIFY(grabber.openRecording(path));
+    grabber.grab();
+    QVERIFY(context.grabResult.consume());
+    QCOMPARE(context.grabResult.readBuffer().colors.size(), 1);
+    QCOMPARE(context.grabResult.readBuffer().colors[0], qRgb(30, 20, 10));
+}
+
+void GrabCalculationTest::testFrameSourcePipe()
+{
+#ifdef FRAME_SOURCE_GRAB_SUPPORT
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QByteArray path = QFile::encodeName(dir.path() + "/frames");
+    QVERIFY(mkfifo(path.constData(), 0600) == 0);
+
+    GrabberContext context;
+    GrabZone zone;
+    zone.rect = QRect(0, 0, 8, 4);
+    zone.isAreaEnabled = true;
+    context.setGrabZones(QList<GrabZone>() << zone);
+
+    FrameSourceGrabber grabber(NULL, &context);
+    QVERIFY(grabber.openSource(QString::fromLocal8Bit(path)));
+
+    // rows are padded to check bytes per line is respected
+    const int bytesPerLine = 8 * 4 + 8;
+    QByteArray frame("PRFS 8 4 40 bgra\n");
+    for (int y = 0; y < 4; ++y) {
+        for (int x = 0; x < 8; ++x)
+            frame.append(char(10)).append(char(20)).append(char(30)).append(char(0));
+        frame.append(QByteArray(bytesPerLine - 8 * 4, char(0xff)));
+    }
+
+    const int fd = open(path.constData(), O_WRONLY);
+    QVERIFY(fd >= 0);
+    QCOMPARE(write(fd, frame.constData(), frame.size()), static_cast<ssize_t>(frame.size()));
+
+    grabber.grab();
+    QVERIFY(context.grabResult.consume());
+    QCOMPARE(context.grabResult.readBuffer().colors.size(), 1);
+    QCOMPARE(context.grabResult.readBuffer().colors[0], qRgb(30, 20, 10));
+
+    close(fd);
+#else
+    QSKIP("frame sources are not supported on the platform");
+#endif
+}
+
+void GrabCalculationTest::testFrameSourceShm()
+{
+#ifdef FRAME_SOURCE_GRAB_SUPPORT
+    const QByteArray name = "/prismatik-test-" + QByteArray::number(getpid());
+    shm_unlink(name.constData());
+    const int fd = shm_open(name.constData(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    QVERIFY(fd >= 0);
+
+    const int slotsCount = 3;
+    const size_t slotSize = 8 * 4 * 4;
+    const size_t shmSize = 64 + slotsCount * slotSize;
+    QVERIFY(ftruncate(fd, shmSize) == 0);
+    void *mapping = mmap(NULL, shmSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    QVERIFY(mapping != MAP_FAILED);
+    unsigned char *shm = static_cast<unsigned char *>(mapping);
+
+    FRAMESOURCE_SHM_HEADER *header = reinterpret_cast<FRAMESOURCE_SHM_HEADER *>(shm);
+    memcpy(header->magic, FRAMESOURCE_MAGIC, sizeof(header->magic));
+    header->version = FRAMESOURCE_VERSION;
+    header->width = 8;
+    header->height = 4;
+    header->bytesPerLine = 8 * 4;
+    header->format = BufferFormatArgb;
+    header->slotsCount = slotsCount;
+    header->dataOffset = 64;
+    header->slotSize = slotSize;
+    header->writeSequence = 0;
+
+    GrabberContext context;
+    GrabZone zone;
+    zone.rect = QRect(0, 0, 8, 4);
+    zone.isAreaEnabled = true;
+    context.setGrabZones(QList<GrabZone>() << zone);
+
+    ShmFrameSourceGrabber grabber(&context);
+    QVERIFY(grabber.openSource("shm:" + QString::fromLatin1(name)));
+
+    publishShmFrame(shm, 1, 10);
+    grabber.grab();
+    QVERIFY(context.grabResult.consume());
+    QCOMPARE(context.grabResult.readBuffer().colors[0], qRgb(30, 20, 10));
+
+    // slot of frame 1 is rewritten after frame 3 is published
+    QVERIFY(grabber.isGrabbedFrameIntact());
+    publishShmFrame(shm, 2, 40);
+    QVERIFY(grabber.isGrabbedFrameIntact());
+    publishShmFrame(shm, 3, 50);
+    QVERIFY(!grabber.isGrabbedFrameIntact());
+
+    grabber.grab();
+    QVERIFY(context.grabResult.consume());
+    QCOMPARE(context.grabResult.readBuffer().colors[0], qRgb(30, 20, 50));
+
+    // ring recreated in place with another layout is remapped, its frame isn't taken meanwhile
+    header->slotsCount = 2;
+    header->slotSize = slotSize + slotSize / 2;
+    QVERIFY(!grabber.isGrabbedFrameIntact());
+    header->writeSequence = 0;
+    publishShmFrame(shm, 1, 60);
+    grabber.grab();
+    QVERIFY(context.grabResult.consume());
+    QCOMPARE(context.grabResult.readBuffer().colors[0], qRgb(30, 20, 60));
+
+    munmap(mapping, shmSize);
+    close(fd);
+    shm_unlink(name.constData());
+#else
+    QSKIP("frame sources are not supported on the platform");
+#endif
+}
+
+void GrabCalculationTest::benchmarkSubsampling_data()
+{
+    QTest::addColumn<int>("step");
+
+    QTest::newRow("every pixel") << 1;
+    QTest::newRow("every 2nd") << 2;
+    QTest::newRow("every 4th") << 4;
+    QTest::newRow("every 8th") << 8;
+}
+
+void GrabCalculationTest::benchmarkSubsampling()
+{
+    using namespace Grab::Calculations;
+    QFETCH(int, step);
+
+    // synthetic frame: gradients, hard edges and some noise
+    const int width = 1920;
+    const int height = 1080;
+    const unsigned int pitch = width * 4;
+    QVector<unsigned char> frame(pitch * height);
+    qsrand(4);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            unsigned char *pixel = frame.data() + pitch * y + x * 4;
+            pixel[0] = (x * 255 / width + (qrand() & 0x1f)) & 0xff;
+            pixel[1] = (y * 255 / height + (qrand() & 0x1f)) & 0xff;
+            pixel[2] = ((x + y) & 0x80) ? 200 : 40;
+            pixel[3] = 0;
+        }
+    }
+
+    const QRect zone(100, 100, 600, 400);
+    QRgb exact, subsampled;
+    calculateAvgColor(&exact, frame.constData(), BufferFormatArgb, pitch, zone);
+    calculateAvgColor(&subsampled, frame.constData(), BufferFormatArgb, pitch, zone, step);
+
+    const int error = qMax(qAbs(qRed(exact) - qRed(subsampled)),
+                           qMax(qAbs(qGreen(exact) - qGreen(subsampled)), qAbs(qBlue(exact) - qBlue(subsampled))));
+    QVERIFY2(error <= 2, qPrintable(QString("max channel error is %1").arg(error)));
+
+    QBENCHMARK {
+        calculateAvgColor(&subsampled, frame.constData(), BufferFormatArgb, pitch, zone, step);
+    }
+}
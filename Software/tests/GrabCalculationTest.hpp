@@ -30,6 +30,8 @@
 #include <QRect>
 #include "enums.hpp"
 #include "calculations.hpp"
+#include "FrameRecording.hpp"
+#include "FrameBufferArena.hpp"
 
 class GrabCalculationTest : public QObject
 {
@@ -40,5 +42,18 @@ public:
     
 private Q_SLOTS:
     void testCase1();
+    void testAccumulationKernelsMatchScalar();
+    void testStepTwoKernelMatchesScalar();
+    void testScanlinePlanMatchesPerZone();
+    void testScanlineSpansAreDisjoint();
+    void testIntegralImageMatchesScanline();
+    void testFrameBufferArena();
+    void testFrameRecordingRoundTrip();
+    void testFrameRecordingCorrupted();
+    void testReplayWithoutDisplay();
+    void testFrameSourcePipe();
+    void testFrameSourceShm();
+    void benchmarkSubsampling_data();
+    void benchmarkSubsampling();
 };
 
@@ -33,6 +33,7 @@
 #include "Settings.hpp"
 #include "enums.hpp"
 #include "SettingsWindowMockup.hpp"
+#include "PipelineStats.hpp"
 
 #include <stdlib.h>
 #include <iostream>
@@ -233,6 +234,34 @@ void LightpackApiTest::testCase_GetProfile()
     QVERIFY(result == cmdProfileCheckResult);
 }
 
+void LightpackApiTest::testCase_GetLatency()
+{
+    // 1..100 us, percentiles are rounded up to histogram buckets, 1/16 of the value at most
+    PipelineStats::reset();
+    for (int i = 1; i <= 100; i++)
+        PipelineStats::record(PipelineStage::Capture, i * 1000);
+
+    LatencyHistogram::Summary summary = PipelineStats::summary(PipelineStage::Capture);
+    QCOMPARE(summary.count, 100);
+    QVERIFY(summary.p50Ns >= 50000 && summary.p50Ns <= 50000 * 17 / 16);
+    QVERIFY(summary.p95Ns >= 95000 && summary.p95Ns <= 95000 * 17 / 16);
+    QVERIFY(summary.p99Ns >= 99000 && summary.p99Ns <= 99000 * 17 / 16);
+    QVERIFY(summary.maxNs >= 100000 && summary.maxNs <= 100000 * 17 / 16);
+
+    writeCommand(m_socket, ApiServer::CmdGetLatency);
+
+    QByteArray result = readResult(m_socket).trimmed();
+    QVERIFY(m_sockReadLineOk);
+
+    QString check = QString("%1capture-%2,%3,%4,%5;averaging-0,0,0,0;")
+            .arg(ApiServer::CmdResultLatency)
+            .arg(summary.p50Ns / 1000).arg(summary.p95Ns / 1000)
+            .arg(summary.p99Ns / 1000).arg(summary.maxNs / 1000);
+    QVERIFY2(QString(result).startsWith(check), result.constData());
+
+    PipelineStats::reset();
+}
+
 void LightpackApiTest::testCase_Lock()
 {
     QTcpSocket sockTryLock;
@@ -40,6 +40,7 @@ private Q_SLOTS:
     void testCase_GetStatusAPI();
     void testCase_GetProfiles();
     void testCase_GetProfile();
+    void testCase_GetLatency();
 
     void testCase_Lock();
     void testCase_Unlock();
@@ -1,6 +1,87 @@
 #include "lightpackmathtest.hpp"
 #include "PrismatikMath.hpp"
+#include "ColorLut.hpp"
+#include "AbstractLedDevice.hpp"
 #include <QtTest>
+#include <QTemporaryDir>
+
+namespace {
+class ColorCorrectionDevice : public AbstractLedDevice
+{
+public:
+    ColorCorrectionDevice() : AbstractLedDevice(NULL) {}
+
+    const QString name() const { return "test"; }
+    void open() {}
+    void close() {}
+    void setColors(const QList<QRgb> &) {}
+    void switchOffLeds() {}
+    void setRefreshDelay(int) {}
+    void setSmoothSlowdown(int) {}
+    void setColorSequence(QString) {}
+    void requestFirmwareVersion() {}
+    size_t maxLedsCount() { return 255; }
+    size_t defaultLedsCount() { return 10; }
+    void setColorDepth(int) {}
+
+    using AbstractLedDevice::applyColorModifications;
+};
+
+/*!
+  Per-LED double precision color correction which correction tables of AbstractLedDevice replaced
+*/
+void applyColorModificationsPerLed(const QList<QRgb> &inColors, QVector<StructRgb> &outColors,
+                                   const QList<WBAdjustment> &wbAdjustments, double gamma, int brightness,
+                                   int luminosityThreshold, bool isMinimumLuminosityEnabled)
+{
+    unsigned short gammaTable[PrismatikMath::GammaTableSize];
+    PrismatikMath::buildGammaTable(gamma, gammaTable);
+    const bool isApplyWBAdjustments = wbAdjustments.count() == inColors.count();
+
+    for (int i = 0; i < inColors.count(); i++) {
+        double k = 4095/255.0;
+        outColors[i].r = qRed(inColors[i])   * k;
+        outColors[i].g = qGreen(inColors[i]) * k;
+        outColors[i].b = qBlue(inColors[i])  * k;
+
+        if (isApplyWBAdjustments) {
+            outColors[i].r *= wbAdjustments[i].red;
+            outColors[i].g *= wbAdjustments[i].green;
+            outColors[i].b *= wbAdjustments[i].blue;
+        }
+
+        PrismatikMath::gammaCorrection(gammaTable, outColors[i]);
+    }
+
+    const bool isThresholdApplied = luminosityThreshold > 0;
+    StructLab avgColor;
+    if (isThresholdApplied && isMinimumLuminosityEnabled)
+        avgColor = PrismatikMath::toLab(PrismatikMath::avgColor(outColors));
+
+    for (int i = 0; i < outColors.count(); ++i) {
+        int dl = isThresholdApplied ? luminosityThreshold - PrismatikMath::lightness(outColors[i]) : 0;
+        if (dl > 0) {
+            if (isMinimumLuminosityEnabled) {
+                StructLab lab = PrismatikMath::toLab(outColors[i]);
+                const int kFadingRange = 5;
+                double fadingCoeff = dl < kFadingRange ? (dl - kFadingRange)*(dl - kFadingRange)/(kFadingRange*kFadingRange): 1;
+                char da = avgColor.a - lab.a;
+                char db = avgColor.b - lab.b;
+                lab.l = luminosityThreshold;
+                lab.a += PrismatikMath::round(da * fadingCoeff);
+                lab.b += PrismatikMath::round(db * fadingCoeff);
+                outColors[i] = PrismatikMath::toRgb(lab);
+            } else {
+                outColors[i].r = 0;
+                outColors[i].g = 0;
+                outColors[i].b = 0;
+            }
+        }
+
+        PrismatikMath::brightnessCorrection(brightness, outColors[i]);
+    }
+}
+}
 
 LightpackMathTest::LightpackMathTest(QObject *parent) :
     QObject(parent)
@@ -15,3 +96,197 @@ void LightpackMathTest::testCase1()
 
     QVERIFY2( PrismatikMath::withChromaHSV(testRgb, PrismatikMath::getChromaHSV(testRgb)) == testRgb, "getChromaHSV() is incorrect");
 }
+
+void LightpackMathTest::testGammaTable()
+{
+    static const double gammas[] = { 0.01, 0.5, 1.0, 2.0, 2.2, 10.0 };
+    unsigned short table[PrismatikMath::GammaTableSize];
+
+    for (size_t g = 0; g < sizeof(gammas) / sizeof(gammas[0]); ++g) {
+        PrismatikMath::buildGammaTable(gammas[g], table);
+
+        for (unsigned i = 0; i < PrismatikMath::GammaTableSize; ++i) {
+            StructRgb expected;
+            expected.r = i;
+            expected.g = PrismatikMath::GammaTableSize - 1 - i;
+            expected.b = i / 2;
+            StructRgb actual = expected;
+
+            PrismatikMath::gammaCorrection(gammas[g], expected);
+            PrismatikMath::gammaCorrection(table, actual);
+
+            QCOMPARE(actual.r, expected.r);
+            QCOMPARE(actual.g, expected.g);
+            QCOMPARE(actual.b, expected.b);
+        }
+    }
+
+    // values above 12bit are clamped
+    StructRgb overflow;
+    overflow.r = 5000;
+    PrismatikMath::gammaCorrection(table, overflow);
+    QCOMPARE(overflow.r, 4095u);
+}
+
+void LightpackMathTest::testDithering()
+{
+    for (unsigned value = 0; value < 4096; ++value) {
+        unsigned char residual = 0;
+        unsigned sum = 0;
+        for (int frame = 0; frame < 16; ++frame) {
+            const unsigned reduced = PrismatikMath::ditherTo8bit(value, residual);
+            QVERIFY(reduced <= 255);
+            QVERIFY(residual < 16);
+            sum += reduced;
+        }
+
+        // 16 frames average to the 12bit value unless it rounds above 255
+        if (value < 4080) {
+            QCOMPARE(sum, value);
+            QCOMPARE(residual, static_cast<unsigned char>(0));
+        } else {
+            QCOMPARE(sum, 255u * 16);
+        }
+    }
+
+    // saturation drops the residual instead of carrying it over
+    unsigned char residual = 15;
+    QCOMPARE(PrismatikMath::ditherTo8bit(4081, residual), 255u);
+    QCOMPARE(residual, static_cast<unsigned char>(0));
+    residual = 15;
+    QCOMPARE(PrismatikMath::ditherTo8bit(5000, residual), 255u);
+    QCOMPARE(residual, static_cast<unsigned char>(0));
+    residual = 15;
+    QCOMPARE(PrismatikMath::ditherTo8bit(4080, residual), 255u);
+    QCOMPARE(residual, static_cast<unsigned char>(15));
+}
+
+void LightpackMathTest::testColorCorrectionTables()
+{
+    const int ledsCount = 64;
+    QList<QRgb> colors;
+    QList<WBAdjustment> wbAdjustments;
+    qsrand(23);
+    for (int i = 0; i < ledsCount; ++i) {
+        // every channel gets 0 and 255 among random values
+        colors << (i < 2 ? qRgb(i * 255, i * 255, i * 255) : qRgb(qrand() & 0xff, (qrand() & 0xff) >> (i % 4), qrand() & 0xff));
+        WBAdjustment wb;
+        wb.red = 0.5 + (qrand() % 1001) / 1000.0;
+        wb.green = 0.5 + (qrand() % 1001) / 1000.0;
+        wb.blue = 0.5 + (qrand() % 1001) / 1000.0;
+        wbAdjustments << wb;
+    }
+
+    static const double gammas[] = { 1.0, 2.2, 0.5 };
+    static const int brightnesses[] = { 100, 57 };
+    static const int thresholds[] = { 0, 25, 60 };
+
+    // one device goes through all the settings, so tables are rebuilt on every change
+    ColorCorrectionDevice device;
+    QVector<StructRgb> expected(ledsCount), actual(ledsCount);
+    for (int wb = 0; wb < 2; ++wb)
+        for (size_t g = 0; g < sizeof(gammas) / sizeof(gammas[0]); ++g)
+            for (size_t b = 0; b < sizeof(brightnesses) / sizeof(brightnesses[0]); ++b)
+                for (size_t t = 0; t < sizeof(thresholds) / sizeof(thresholds[0]); ++t)
+                    for (int minimumLuminosity = 0; minimumLuminosity < 2; ++minimumLuminosity) {
+                        const QList<WBAdjustment> wbCoefs = wb ? wbAdjustments : QList<WBAdjustment>();
+                        device.updateWBAdjustments(wbCoefs);
+                        device.setGamma(gammas[g]);
+                        device.setBrightness(brightnesses[b]);
+                        device.setLuminosityThreshold(thresholds[t]);
+                        device.setMinimumLuminosityThresholdEnabled(minimumLuminosity);
+
+                        applyColorModificationsPerLed(colors, expected, wbCoefs, gammas[g], brightnesses[b], thresholds[t], minimumLuminosity);
+                        device.applyColorModifications(colors, actual);
+
+                        for (int i = 0; i < ledsCount; ++i) {
+                            if (actual[i].r != expected[i].r || actual[i].g != expected[i].g || actual[i].b != expected[i].b)
+                                QFAIL(qPrintable(QString("LED %1 is %2,%3,%4 instead of %5,%6,%7 with wb %8, gamma %9, brightness %10, threshold %11, minimum luminosity %12")
+                                                 .arg(i).arg(actual[i].r).arg(actual[i].g).arg(actual[i].b)
+                                                 .arg(expected[i].r).arg(expected[i].g).arg(expected[i].b)
+                                                 .arg(wb).arg(gammas[g]).arg(brightnesses[b]).arg(thresholds[t]).arg(minimumLuminosity)));
+                        }
+                    }
+}
+
+void LightpackMathTest::testLightness()
+{
+    for (unsigned r = 0; r < 4096; r += 65) {
+        for (unsigned g = 0; g < 4096; g += 65) {
+            for (unsigned b = 0; b < 4096; b += 65) {
+                StructRgb rgb;
+                rgb.r = r;
+                rgb.g = g;
+                rgb.b = b;
+                const int expected = PrismatikMath::toLab(rgb).l;
+                const int actual = PrismatikMath::lightness(rgb);
+                if (qAbs(actual - expected) > 1)
+                    QFAIL(qPrintable(QString("L* of %1,%2,%3 is %4 instead of %5").arg(r).arg(g).arg(b).arg(actual).arg(expected)));
+            }
+        }
+    }
+
+    StructRgb white;
+    white.r = white.g = white.b = 4095;
+    QCOMPARE(int(PrismatikMath::lightness(white)), 100);
+    QCOMPARE(int(PrismatikMath::lightness(StructRgb())), 0);
+}
+
+void LightpackMathTest::testColorLut()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    // rotates channels, linear, so interpolation is exact up to rounding
+    const int size = 17;
+    const QString cubePath = dir.path() + "/rotate.cube";
+    QFile cube(cubePath);
+    QVERIFY(cube.open(QIODevice::WriteOnly | QIODevice::Text));
+    QTextStream stream(&cube);
+    stream << "# test LUT\nTITLE \"rotate\"\nLUT_3D_SIZE " << size << "\n\n";
+    for (int b = 0; b < size; ++b)
+        for (int g = 0; g < size; ++g)
+            for (int r = 0; r < size; ++r)
+                stream << double(g) / (size - 1) << " " << double(b) / (size - 1) << " " << double(r) / (size - 1) << "\n";
+    stream.flush();
+    cube.close();
+
+    const QString cacheDir = dir.path() + "/cache";
+    for (int pass = 0; pass < 2; ++pass) {
+        ColorLut lut;
+        QVERIFY(lut.load(cubePath, cacheDir));
+        QCOMPARE(lut.size(), size);
+        // the first pass writes the cache, the second one reads it
+        QVERIFY(QFileInfo(ColorLut::cacheFilePath(cubePath, cacheDir)).exists());
+
+        for (unsigned r = 0; r <= 4095; r += 89)
+            for (unsigned g = 0; g <= 4095; g += 97)
+                for (unsigned b = 0; b <= 4095; b += 101) {
+                    StructRgb rgb;
+                    rgb.r = r;
+                    rgb.g = g;
+                    rgb.b = b;
+                    lut.map(rgb);
+                    QVERIFY(qAbs(int(rgb.r) - int(g)) <= 1);
+                    QVERIFY(qAbs(int(rgb.g) - int(b)) <= 1);
+                    QVERIFY(qAbs(int(rgb.b) - int(r)) <= 1);
+                }
+
+        // corners are exact, values above 12bit are clamped
+        StructRgb corner;
+        corner.r = 5000;
+        corner.b = 4095;
+        lut.map(corner);
+        QCOMPARE(corner.r, 0u);
+        QCOMPARE(corner.g, 4095u);
+        QCOMPARE(corner.b, 4095u);
+    }
+
+    ColorLut broken;
+    QFile truncated(dir.path() + "/truncated.cube");
+    QVERIFY(truncated.open(QIODevice::WriteOnly));
+    truncated.write("LUT_3D_SIZE 2\n0 0 0\n1 1 1\n");
+    truncated.close();
+    QVERIFY(!broken.load(truncated.fileName(), QString()));
+    QVERIFY(!broken.isLoaded());
+}
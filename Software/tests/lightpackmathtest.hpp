@@ -11,6 +11,11 @@ public:
     
 private slots:
     void testCase1();
+    void testGammaTable();
+    void testDithering();
+    void testColorCorrectionTables();
+    void testLightness();
+    void testColorLut();
 };
 
 #endif // LIGHTPACKMATHTEST_HPP
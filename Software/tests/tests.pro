@@ -37,11 +37,17 @@ HEADERS += \
     ../src/enums.hpp \
     ../src/ApiServerSetColorTask.hpp \
     ../src/ApiServer.hpp \
+    ../src/PipelineStats.hpp \
+    ../src/ColorLut.hpp \
+    ../src/AbstractLedDevice.hpp \
+    ../src/FrameTracer.hpp \
     ../src/debug.h \
     ../src/Settings.hpp \
     ../src/Plugin.hpp \
     ../src/LightpackPluginInterface.hpp \
     ../grab/include/calculations.hpp \
+    ../grab/include/FrameRecording.hpp \
+    ../grab/include/FrameBufferArena.hpp \
     ../math/include/PrismatikMath.hpp \
     SettingsWindowMockup.hpp \
     GrabCalculationTest.hpp \
@@ -53,6 +59,10 @@ HEADERS += \
 SOURCES += \
     ../src/ApiServerSetColorTask.cpp \
     ../src/ApiServer.cpp \
+    ../src/PipelineStats.cpp \
+    ../src/ColorLut.cpp \
+    ../src/AbstractLedDevice.cpp \
+    ../src/FrameTracer.cpp \
     ../src/Settings.cpp \
     ../src/Plugin.cpp \
     ../src/LightpackPluginInterface.cpp \
@@ -64,6 +74,11 @@ SOURCES += \
     AppVersionTest.cpp \
     ../src/UpdatesProcessor.cpp
 
+unix:!macx{
+    # grabbers of libgrab
+    LIBS += -lrt -lXrandr -lXdamage -lXfixes -lXext -lX11 -lxcb-shm -lxcb
+}
+
 win32{
     HEADERS += \
         HooksTest.h \